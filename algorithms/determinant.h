@@ -1,37 +1,115 @@
 #pragma once
 
+#include <vector>
 #include "../core/matrix.h"
+#include "lu_decomposition.h"
 
 namespace notlab
 {   
     /**
-     * @brief Calculates determinant by Laplace method.
+     * @struct LogDeterminant
+     * @brief Determinant stored as sign * exp(logAbs), doesn't overflow.
+     * @tparam T Floating type.
+     */
+    template<typename T>
+    struct LogDeterminant{
+        /// -1, 0 (singular) or +1.
+        int sign;
+        /// Natural logarithm of |det|, -infinity when singular.
+        T logAbs;
+    };
+
+    /**
+     * @brief Calculates determinant from LU factorization with partial pivoting, O(n^3).
      * 
      * @tparam T Type of Matrix.
      * @param matrix Matrix to calculate determinant.
-     * @return float Determinant.
+     * @return lu_value_t<T> Determinant (double for Matrix<double>).
      */
     template<typename T>
-    float determinantByLaplace(const Matrix<T>& matrix){
+    lu_value_t<T> determinant(const Matrix<T>& matrix){
         if(!matrix.isSqure()){
             throw std::runtime_error("Matrix must be square to calculate determinant");
         }
+        return luFactorize(matrix).determinant();
+    }
+
+    /**
+     * @brief Calculates sign and log of absolute value of determinant.
+     * @details Use for large matrices where determinant over- or underflows.
+     * 
+     * @tparam T Type of Matrix.
+     * @param matrix Matrix to calculate determinant.
+     * @return LogDeterminant<lu_value_t<T>> Sign and log|det|.
+     */
+    template<typename T>
+    LogDeterminant<lu_value_t<T>> logDeterminant(const Matrix<T>& matrix){
+        if(!matrix.isSqure()){
+            throw std::runtime_error("Matrix must be square to calculate determinant");
+        }
+        LuFactorization<lu_value_t<T>> lu = luFactorize(matrix);
+        return {lu.determinantSign(), lu.logAbsDeterminant()};
+    }
+
+    /**
+     * @brief Laplace expansion of a view along the first row.
+     * 
+     * @tparam T Type of Matrix.
+     * @param matrix Square view to calculate determinant.
+     * @param scratch Workspace for minors of all deeper levels, (n-1)^2 + (n-2)^2 + ... elements.
+     * @return lu_value_t<T> Determinant.
+     */
+    template<typename T>
+    lu_value_t<T> determinantByLaplace(const MatrixView<const T>& matrix, T* scratch){
+        using resultType = lu_value_t<T>;
         size_t dimensions = matrix.getNumberOfRows();
         if(dimensions == 1){
-            return static_cast<float>(matrix(1,1));
+            return static_cast<resultType>(matrix(1,1));
         }
         if(dimensions == 2){
-            return matrix(1,1) * matrix(2,2) - matrix(1,2) * matrix(2,1);
+            return static_cast<resultType>(matrix(1,1)) * matrix(2,2) - static_cast<resultType>(matrix(1,2)) * matrix(2,1);
         }
 
-        float determinant = 0;
+        MatrixView<T> minor(scratch, dimensions - 1, dimensions - 1);
+        T* deeperScratch = scratch + (dimensions - 1) * (dimensions - 1);
+
+        resultType determinant = 0;
         for(size_t i = 1; i<=dimensions; i++){
-            Matrix<T> minor = matrix.minorMatrix(1, i);
+            matrix.minor(1, i).copyTo(minor);
             int sign = ((i % 2) ? 1 : -1);
-            determinant += sign * matrix(1,i) * determinantByLaplace(minor);
+            determinant += sign * static_cast<resultType>(matrix(1,i)) * determinantByLaplace(MatrixView<const T>(minor), deeperScratch);
         }
 
         return determinant;
     }
 
+    /**
+     * @brief Calculates determinant by Laplace method.
+     * @details
+     *   O(n!) reference implementation, only practical for small n.
+     *   Use determinant() for anything else.
+     * 
+     * @tparam T Type of Matrix.
+     * @param matrix Matrix to calculate determinant.
+     * @return lu_value_t<T> Determinant.
+     */
+    template<typename T>
+    lu_value_t<T> determinantByLaplace(const Matrix<T>& matrix){
+        if(!matrix.isSqure()){
+            throw std::runtime_error("Matrix must be square to calculate determinant");
+        }
+        size_t dimensions = matrix.getNumberOfRows();
+        if(dimensions == 0){
+            return 0;
+        }
+
+        size_t scratchSize = 0;
+        for(size_t i = 1; i < dimensions; i++){
+            scratchSize += i * i;
+        }
+        std::vector<T> scratch(scratchSize);
+
+        return determinantByLaplace(matrix.view(), scratch.data());
+    }
+
 } // namespace notlab
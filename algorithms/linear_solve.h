@@ -14,48 +14,37 @@ namespace notlab
      * @tparam U 
      * @param A Value Matrix.
      * @param b Result Vector.
-     * @return VectorF X Vector.
+     * @return Vector<lu_value_t<T>> X Vector.
      */
     template<typename T, typename U>
-    VectorF linearSolveByLu(const Matrix<T>& A, const Vector<U>& b){
+    Vector<lu_value_t<T>> linearSolveByLu(const Matrix<T>& A, const Vector<U>& b){
         if(!A.isSqure()){
             throw std::runtime_error("Matrix A must be square in order to solve equation");
         }
 
-
-        //MatrixF matrixA = castMatrix<float>(A);
-        VectorF vectorb = castVector<float>(b);
-
-        std::pair<MatrixF, MatrixF> lu = gaussDollitle(A);
-
-        VectorF y = forwardSubstitution(lu.first, vectorb);
-        
-        VectorF x = backwardSubstitution(lu.second, y);
-
-        return x;
-
+        return luFactorize(A).solve(b);
     }
 
     /**
-     * @brief Solves linear equation Ax = b
+     * @brief Solves linear equation AX = B for every column of B.
+     * @details
+     *   A is factorized once. To solve against the same A repeatedly, keep
+     *   luFactorize(A) and call its solve or solveInPlace instead.
      * 
      * @tparam T 
      * @tparam U 
      * @param A Value Matrix.
-     * @param b result Matrix.
-     * @return VectorF X vector.
+     * @param B Result Matrix n x k, one right hand side per column.
+     * @return Matrix<lu_value_t<T>> X Matrix n x k.
      */
     template<typename T, typename U>
-    VectorF linearSolveByLu(const Matrix<T>& A, const Matrix<U>& b){
+    Matrix<lu_value_t<T>> linearSolveByLu(const Matrix<T>& A, const Matrix<U>& B){
         if(!A.isSqure()){
             throw std::runtime_error("Matrix A must be square in order to solve equation");
         }
-        if(b.getNumberOfColums() != 1){
-            throw std::runtime_error("Matrix A must have one column to solve equation");
-        }
-        Vector<U> bVector = b.getColumn(1);
-        return linearSolveByLu(A, bVector);
+
+        return luFactorize(A).solve(B);
     }
 
 
-} // namespace notlab
\ No newline at end of file
+} // namespace notlab
@@ -1,14 +1,347 @@
 #pragma once
 
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <type_traits>
+#include <vector>
 #include "../core/matrix.h"
+#include "../core/gemm.h"
+#include "substitution.h"
 
 namespace notlab
 {
+    /**
+     * @brief Floating type LU factorization of Matrix<T> is computed in.
+     * @details double stays double, int and float are factorized in float.
+     */
+    template<typename T>
+    using lu_value_t = std::conditional_t<std::is_same_v<T, double>, double, float>;
+
+    /**
+     * @class LuFactorization
+     * @tparam T Floating type of factorization (float or double).
+     * @brief Compact LU factorization with partial pivoting, PA = LU.
+     * @details
+     *   L (unit lower triangular, diagonal not stored) and U share one
+     *   n x n Matrix. Row i of PA is row getPermutation()[i] of A.
+     *   Factorization is computed once and reused by solves, inverse and
+     *   determinant.
+     */
+    template<typename T>
+    class LuFactorization{
+        private:
+            Matrix<T> m_lu;
+            std::vector<size_t> m_permutation;
+            int m_pivotSign = 1;
+            bool m_singular = false;
+
+            /// Number of columns factorized at once before the trailing gemm update.
+            static constexpr size_t s_blockSize = 64;
+
+            void swapRows(size_t first, size_t second){
+                if(first == second){
+                    return;
+                }
+                size_t n = m_lu.getNumberOfColums();
+                T* data = m_lu.getRawData();
+                std::swap_ranges(data + first * n, data + (first + 1) * n, data + second * n);
+                std::swap(m_permutation[first], m_permutation[second]);
+                m_pivotSign = -m_pivotSign;
+            }
+
+            /**
+             * @brief Unblocked pivoted factorization of columns [from, from+width).
+             * @details Whole rows are swapped, updates stay inside the panel.
+             */
+            void factorizePanel(size_t from, size_t width){
+                size_t n = m_lu.getNumberOfRows();
+                MatrixView<T> a = m_lu.view();
+
+                for(size_t k = from; k < from + width; k++){
+                    size_t pivotRow = k;
+                    T pivotValue = std::abs(a.unchecked(k, k));
+                    for(size_t i = k + 1; i < n; i++){
+                        T value = std::abs(a.unchecked(i, k));
+                        if(value > pivotValue){
+                            pivotValue = value;
+                            pivotRow = i;
+                        }
+                    }
+                    swapRows(k, pivotRow);
+
+                    T pivot = a.unchecked(k, k);
+                    if(pivot == T(0)){
+                        m_singular = true;
+                        continue;
+                    }
+
+                    for(size_t i = k + 1; i < n; i++){
+                        T factor = a.unchecked(i, k) / pivot;
+                        a.unchecked(i, k) = factor;
+                        for(size_t j = k + 1; j < from + width; j++){
+                            a.unchecked(i, j) -= factor * a.unchecked(k, j);
+                        }
+                    }
+                }
+            }
+
+            /**
+             * @brief Right-looking blocked factorization.
+             * @details
+             *   For each panel: factorize it, apply L11^-1 to the block row
+             *   on its right and update trailing matrix with gemm.
+             */
+            void factorize(){
+                size_t n = m_lu.getNumberOfRows();
+                T* data = m_lu.getRawData();
+
+                for(size_t j = 0; j < n; j += s_blockSize){
+                    size_t width = std::min(s_blockSize, n - j);
+                    factorizePanel(j, width);
+
+                    size_t rest = n - j - width;
+                    if(rest == 0){
+                        continue;
+                    }
+
+                    T* a12 = data + j * n + j + width;
+                    for(size_t k = 0; k < width; k++){
+                        const T* rowK = a12 + k * n;
+                        for(size_t i = k + 1; i < width; i++){
+                            T factor = data[(j + i) * n + j + k];
+                            T* rowI = a12 + i * n;
+                            for(size_t c = 0; c < rest; c++){
+                                rowI[c] -= factor * rowK[c];
+                            }
+                        }
+                    }
+
+                    const T* a21 = data + (j + width) * n + j;
+                    T* a22 = data + (j + width) * n + j + width;
+                    gemm(rest, rest, width, a21, n, a12, n, a22, n, T(-1));
+                }
+            }
+
+        public:
+            /**
+             * @brief Factorizes square Matrix.
+             *
+             * @tparam U Type of Matrix.
+             * @param matrixToDecompose Square Matrix A.
+             * @throws std::runtime_error if Matrix isn't square.
+             */
+            template<typename U>
+            explicit LuFactorization(const Matrix<U>& matrixToDecompose)
+            : m_lu(castMatrix<T>(matrixToDecompose)), m_permutation(matrixToDecompose.getNumberOfRows()){
+                if(!matrixToDecompose.isSqure()){
+                    throw std::runtime_error("Matrix must be square to decompose");
+                }
+                for(size_t i = 0; i < m_permutation.size(); i++){
+                    m_permutation[i] = i;
+                }
+                m_lu.setName("LU");
+                factorize();
+            }
+
+            /**
+             * @brief Get compact storage, L below diagonal and U on and above.
+             */
+            const Matrix<T>& getLU() const { return m_lu; }
+
+            /**
+             * @brief Get row permutation, row i of PA is row getPermutation()[i] of A.
+             */
+            const std::vector<size_t>& getPermutation() const { return m_permutation; }
+
+            /**
+             * @brief Get sign of permutation (+1 or -1).
+             */
+            int getPivotSign() const { return m_pivotSign; }
+
+            /**
+             * @brief Checking if zero pivot was found.
+             */
+            bool isSingular() const { return m_singular; }
+
+            /**
+             * @brief Get dimension of factorized Matrix.
+             */
+            size_t getDimension() const { return m_lu.getNumberOfRows(); }
+
+            /**
+             * @brief Get unit lower triangular Matrix L.
+             */
+            Matrix<T> getL() const {
+                size_t n = getDimension();
+                Matrix<T> l = Matrix<T>::identity(n, "L");
+                for(size_t i = 0; i < n; i++){
+                    for(size_t j = 0; j < i; j++){
+                        l.view().unchecked(i, j) = m_lu.view().unchecked(i, j);
+                    }
+                }
+                return l;
+            }
+
+            /**
+             * @brief Get upper triangular Matrix U.
+             */
+            Matrix<T> getU() const {
+                size_t n = getDimension();
+                Matrix<T> u = Matrix<T>::zeros(n, n, "U");
+                for(size_t i = 0; i < n; i++){
+                    for(size_t j = i; j < n; j++){
+                        u.view().unchecked(i, j) = m_lu.view().unchecked(i, j);
+                    }
+                }
+                return u;
+            }
+
+            /**
+             * @brief Determinant of factorized Matrix, sign * prod(diag(U)).
+             * @details May overflow for large n, see logAbsDeterminant.
+             */
+            T determinant() const {
+                if(m_singular){
+                    return T(0);
+                }
+                T determinant = static_cast<T>(m_pivotSign);
+                for(size_t i = 0; i < getDimension(); i++){
+                    determinant *= m_lu.view().unchecked(i, i);
+                }
+                return determinant;
+            }
+
+            /**
+             * @brief Sign of determinant (-1, 0 or +1).
+             */
+            int determinantSign() const {
+                if(m_singular){
+                    return 0;
+                }
+                int sign = m_pivotSign;
+                for(size_t i = 0; i < getDimension(); i++){
+                    if(m_lu.view().unchecked(i, i) < T(0)){
+                        sign = -sign;
+                    }
+                }
+                return sign;
+            }
+
+            /**
+             * @brief Natural logarithm of |det(A)|, sum of log|U(i,i)|.
+             * @details Doesn't overflow, -infinity for singular Matrix.
+             */
+            T logAbsDeterminant() const {
+                if(m_singular){
+                    return -std::numeric_limits<T>::infinity();
+                }
+                T logDeterminant = 0;
+                for(size_t i = 0; i < getDimension(); i++){
+                    logDeterminant += std::log(std::abs(m_lu.view().unchecked(i, i)));
+                }
+                return logDeterminant;
+            }
+
+            /**
+             * @brief Solves Ax = b in place.
+             *
+             * @param x Right hand side b on entry, solution x on exit.
+             * @throws std::runtime_error if Matrix is singular.
+             */
+            void solveInPlace(const VectorView<T>& x) const {
+                if(m_singular){
+                    throw std::runtime_error("Matrix is singular");
+                }
+                if(x.getSize() != getDimension()){
+                    throw std::runtime_error("Number of element in Vector don't match with dimension of matrix");
+                }
+                std::vector<T> permuted(getDimension());
+                for(size_t i = 0; i < permuted.size(); i++){
+                    permuted[i] = x[m_permutation[i]];
+                }
+                for(size_t i = 0; i < permuted.size(); i++){
+                    x[i] = permuted[i];
+                }
+                forwardSubstitutionInPlace(m_lu.view(), x, true);
+                backwardSubstitutionInPlace(m_lu.view(), x);
+            }
+
+            /**
+             * @brief Solves AX = B for all columns of B in place.
+             * @details Rows are permuted once, then blocked triangular solves run on all columns together.
+             *
+             * @param X n x k right hand sides B on entry, solutions X on exit.
+             * @throws std::runtime_error if Matrix is singular.
+             */
+            void solveInPlace(const MatrixView<T>& X) const {
+                if(m_singular){
+                    throw std::runtime_error("Matrix is singular");
+                }
+                if(X.getNumberOfRows() != getDimension()){
+                    throw std::runtime_error("Number of rows of Matrix B don't match with dimension of matrix");
+                }
+                size_t columns = X.getNumberOfColums();
+                std::vector<T> permuted(getDimension() * columns);
+                MatrixView<T> permutedView(permuted.data(), getDimension(), columns);
+                for(size_t i = 0; i < getDimension(); i++){
+                    for(size_t c = 0; c < columns; c++){
+                        permutedView.unchecked(i, c) = X.unchecked(m_permutation[i], c);
+                    }
+                }
+                X.copyFrom(permutedView);
+                forwardSubstitutionInPlace(m_lu.view(), X, true);
+                backwardSubstitutionInPlace(m_lu.view(), X);
+            }
+
+            /**
+             * @brief Solves Ax = b.
+             *
+             * @tparam U Type of Vector.
+             * @param b Right hand side.
+             * @return Vector<T> Solution x.
+             */
+            template<typename U>
+            Vector<T> solve(const Vector<U>& b) const {
+                Vector<T> x = castVector<T>(b);
+                solveInPlace(x.view());
+                return x;
+            }
+
+            /**
+             * @brief Solves AX = B for n x k Matrix B.
+             *
+             * @tparam U Type of Matrix.
+             * @param B Right hand sides, one per column.
+             * @return Matrix<T> Solutions X, one per column.
+             */
+            template<typename U>
+            Matrix<T> solve(const Matrix<U>& B) const {
+                Matrix<T> X = castMatrix<T>(B);
+                X.setName("X");
+                solveInPlace(X.view());
+                return X;
+            }
+    };
+
+    /**
+     * @brief LU factorization with partial pivoting of Matrix.
+     *
+     * @tparam T Type of matrix
+     * @param matrixToDecompose Square Matrix that is decomposed
+     * @return LuFactorization<lu_value_t<T>> Reusable factorization PA = LU
+     */
+    template<typename T>
+    LuFactorization<lu_value_t<T>> luFactorize(const Matrix<T>& matrixToDecompose){
+        return LuFactorization<lu_value_t<T>>(matrixToDecompose);
+    }
+
     /**
      * @brief Decomposition of Matrix from Gauss Dollitle algorithm
-     * 
+     * @deprecated No pivoting, fails on zero leading minors. Use luFactorize.
+     *
      * @tparam T Type of matrix
-     * @param matrixToDecompose Matrix that is decomposed 
+     * @param matrixToDecompose Matrix that is decomposed
      * @return std::pair<MatrixF, MatrixF> Pair of Matrix L and Matrix U
      */
     template<typename T>
@@ -21,20 +354,20 @@ namespace notlab
         MatrixF uMatrix = MatrixF::zeros(dimentionOfMatrix, dimentionOfMatrix, "U");
         MatrixF lMatrix = MatrixF::identity(dimentionOfMatrix, "L");
 
+        MatrixView<const T> a = matrixToDecompose.view();
+        MatrixView<float> l = lMatrix.view();
+        MatrixView<float> u = uMatrix.view();
+
         for(size_t i = 1; i<= dimentionOfMatrix; i++){
+            VectorView<float> lRow = l.row(i).subView(1, i-1);
             for(size_t j = i; j <= dimentionOfMatrix; j++){
-                float sum = 0;
-                for(size_t k = 1; k<=i-1; k++){
-                    sum += lMatrix(i,k) * uMatrix(k,j);
-                }
-                uMatrix(i,j) = matrixToDecompose(i,j) - sum;
+                float sum = dot(lRow, u.column(j).subView(1, i-1));
+                u.unchecked(i-1, j-1) = a.unchecked(i-1, j-1) - sum;
             }
+            VectorView<float> uColumn = u.column(i).subView(1, i-1);
             for(size_t j = i+1; j<=dimentionOfMatrix; j++){
-                float sum = 0;
-                for(size_t k = 1; k<=i-1; k++){
-                    sum += lMatrix(j,k) * uMatrix(k,i); 
-                }   
-                lMatrix(j,i) = (1/uMatrix(i,i)) * (matrixToDecompose(j,i) - sum);
+                float sum = dot(l.row(j).subView(1, i-1), uColumn);
+                l.unchecked(j-1, i-1) = (1/u.unchecked(i-1, i-1)) * (a.unchecked(j-1, i-1) - sum);
             }
         }
         std::pair<MatrixF, MatrixF> matrixToReturn = std::make_pair(lMatrix, uMatrix);
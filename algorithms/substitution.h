@@ -1,10 +1,161 @@
 #pragma once
 
+#include <algorithm>
 #include "../core/matrix.h"
 #include "../core/vector.h"
+#include "../core/gemm.h"
 
 namespace notlab{
 
+    /**
+     * @brief Performs forward Substitution in place, x := L^-1 x.
+     * 
+     * @tparam T Type of Matrix.
+     * @tparam U Type of Vector.
+     * @param L Lower triangular view, elements above diagonal are ignored.
+     * @param x Right hand side on entry, solution on exit.
+     * @param unitDiagonal Treat diagonal of L as ones (compact LU storage).
+     */
+    template<typename T, typename U>
+    void forwardSubstitutionInPlace(const MatrixView<const T>& L, const VectorView<U>& x, bool unitDiagonal = false){
+        size_t dimensionOfMatrix = L.getNumberOfRows();
+        for(size_t i = 0; i < dimensionOfMatrix; i++){
+            U value = 0;
+            for(size_t j = 0; j < i; j++){
+                value += L.unchecked(i, j) * x[j];
+            }
+            x[i] = x[i] - value;
+            if(!unitDiagonal){
+                x[i] = x[i] / L.unchecked(i, i);
+            }
+        }
+    }
+
+    /**
+     * @brief Performs backward Substitution in place, x := U^-1 x.
+     * 
+     * @tparam T Type of Matrix.
+     * @tparam V Type of Vector.
+     * @param U Upper triangular view, elements below diagonal are ignored.
+     * @param x Right hand side on entry, solution on exit.
+     */
+    template<typename T, typename V>
+    void backwardSubstitutionInPlace(const MatrixView<const T>& U, const VectorView<V>& x){
+        size_t dimensionOfMatrix = U.getNumberOfRows();
+        for(size_t i = dimensionOfMatrix; i-- > 0;){
+            V value = 0;
+            for(size_t j = i + 1; j < dimensionOfMatrix; j++){
+                value += U.unchecked(i, j) * x[j];
+            }
+            x[i] = (x[i] - value) / U.unchecked(i, i);
+        }
+    }
+
+
+    /// Rows of triangular Matrix solved at once by multi right hand side substitution.
+    constexpr size_t substitutionBlockSize = 64;
+
+    /**
+     * @brief X := X - A * B, with gemm when rows of all views are contiguous.
+     */
+    template<typename T, typename U>
+    void substitutionUpdate(const MatrixView<const T>& A, const MatrixView<const U>& B, const MatrixView<U>& X){
+        size_t rows = X.getNumberOfRows();
+        size_t cols = X.getNumberOfColums();
+        size_t inner = A.getNumberOfColums();
+        if(A.getColStride() == 1 && B.getColStride() == 1 && X.getColStride() == 1){
+            gemm(rows, cols, inner, A.getRawData(), A.getRowStride(), B.getRawData(), B.getRowStride(),
+                 X.getRawData(), X.getRowStride(), U(-1));
+            return;
+        }
+        for(size_t i = 0; i < rows; i++){
+            for(size_t p = 0; p < inner; p++){
+                U factor = A.unchecked(i, p);
+                for(size_t j = 0; j < cols; j++){
+                    X.unchecked(i, j) -= factor * B.unchecked(p, j);
+                }
+            }
+        }
+    }
+
+    /**
+     * @brief Performs forward Substitution in place for many right hand sides, X := L^-1 X.
+     * @details
+     *   Blocked: rows of X in a block are first updated with everything
+     *   already solved in one gemm, then the diagonal block is substituted
+     *   row by row.
+     * 
+     * @tparam T Type of Matrix.
+     * @tparam U Type of right hand sides.
+     * @param L Lower triangular n x n view, elements above diagonal are ignored.
+     * @param X n x k right hand sides on entry, solutions on exit.
+     * @param unitDiagonal Treat diagonal of L as ones (compact LU storage).
+     */
+    template<typename T, typename U>
+    void forwardSubstitutionInPlace(const MatrixView<const T>& L, const MatrixView<U>& X, bool unitDiagonal = false){
+        size_t dimensionOfMatrix = L.getNumberOfRows();
+        size_t numberOfColumns = X.getNumberOfColums();
+        for(size_t from = 0; from < dimensionOfMatrix; from += substitutionBlockSize){
+            size_t width = std::min(substitutionBlockSize, dimensionOfMatrix - from);
+            if(from > 0){
+                substitutionUpdate(L.block(from + 1, 1, width, from),
+                                   MatrixView<const U>(X.block(1, 1, from, numberOfColumns)),
+                                   X.block(from + 1, 1, width, numberOfColumns));
+            }
+            for(size_t i = from; i < from + width; i++){
+                for(size_t j = from; j < i; j++){
+                    U factor = L.unchecked(i, j);
+                    for(size_t c = 0; c < numberOfColumns; c++){
+                        X.unchecked(i, c) -= factor * X.unchecked(j, c);
+                    }
+                }
+                if(!unitDiagonal){
+                    U diagonal = L.unchecked(i, i);
+                    for(size_t c = 0; c < numberOfColumns; c++){
+                        X.unchecked(i, c) = X.unchecked(i, c) / diagonal;
+                    }
+                }
+            }
+        }
+    }
+
+    /**
+     * @brief Performs backward Substitution in place for many right hand sides, X := U^-1 X.
+     * @details Blocked from the bottom, same scheme as forwardSubstitutionInPlace.
+     * 
+     * @tparam T Type of Matrix.
+     * @tparam V Type of right hand sides.
+     * @param U Upper triangular n x n view, elements below diagonal are ignored.
+     * @param X n x k right hand sides on entry, solutions on exit.
+     */
+    template<typename T, typename V>
+    void backwardSubstitutionInPlace(const MatrixView<const T>& U, const MatrixView<V>& X){
+        size_t dimensionOfMatrix = U.getNumberOfRows();
+        size_t numberOfColumns = X.getNumberOfColums();
+        for(size_t to = dimensionOfMatrix; to > 0;){
+            size_t width = std::min(substitutionBlockSize, to);
+            size_t from = to - width;
+            size_t solved = dimensionOfMatrix - to;
+            if(solved > 0){
+                substitutionUpdate(U.block(from + 1, to + 1, width, solved),
+                                   MatrixView<const V>(X.block(to + 1, 1, solved, numberOfColumns)),
+                                   X.block(from + 1, 1, width, numberOfColumns));
+            }
+            for(size_t i = to; i-- > from;){
+                for(size_t j = i + 1; j < to; j++){
+                    V factor = U.unchecked(i, j);
+                    for(size_t c = 0; c < numberOfColumns; c++){
+                        X.unchecked(i, c) -= factor * X.unchecked(j, c);
+                    }
+                }
+                V diagonal = U.unchecked(i, i);
+                for(size_t c = 0; c < numberOfColumns; c++){
+                    X.unchecked(i, c) = X.unchecked(i, c) / diagonal;
+                }
+            }
+            to = from;
+        }
+    }
 
     /**
      * @brief Performs forward Substitution.
@@ -24,15 +175,8 @@ namespace notlab{
             throw std::runtime_error("Number of element in Vector don't match with dimension of matrix");
         }
 
-        Vector<T> substitudedVector = Vector<T>::zeros(dimensionOfMatrix);
-        
-        for(size_t i = 1; i<=dimensionOfMatrix; i++){
-            T value = 0;
-            for(size_t j = 1; j < i; j++){
-                value += L(i,j) * substitudedVector(j);
-            }
-            substitudedVector(i) = (b(i) - value) / L(i,i);
-        }
+        Vector<T> substitudedVector = b;
+        forwardSubstitutionInPlace(L.view(), substitudedVector.view());
 
         return substitudedVector;
     }
@@ -55,15 +199,8 @@ namespace notlab{
             throw std::runtime_error("Number of element in Vector don't match with dimension of matrix");
         }
 
-        Vector<T> substitudedVector = Vector<T>::zeros(dimensionOfMatrix);
-        
-        for(size_t i = dimensionOfMatrix; i >= 1; i--){
-            T value = 0;
-            for(size_t j = dimensionOfMatrix; j > i; j--){
-                value += U(i,j) * substitudedVector(j);
-            }
-            substitudedVector(i) = (b(i) - value) / U(i,i);
-        }
+        Vector<T> substitudedVector = b;
+        backwardSubstitutionInPlace(U.view(), substitudedVector.view());
 
         return substitudedVector;
     }
@@ -0,0 +1,63 @@
+#include "determinant.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+
+template <typename T> notlab::Matrix<T> randomMatrix(size_t n) {
+  std::mt19937 generator(42);
+  std::uniform_real_distribution<double> distribution(-1.0, 1.0);
+  notlab::Matrix<T> matrix = notlab::Matrix<T>::zeros(n, n);
+  T *data = matrix.getRawData();
+  for (size_t i = 0; i < n * n; i++) {
+    data[i] = static_cast<T>(distribution(generator));
+  }
+  return matrix;
+}
+
+template <typename F> double secondsOf(F &&function) {
+  auto start = std::chrono::steady_clock::now();
+  function();
+  auto stop = std::chrono::steady_clock::now();
+  return std::chrono::duration<double>(stop - start).count();
+}
+
+// Laplace expansion is O(n!), only run it where it finishes in seconds.
+constexpr size_t laplaceMaxSize = 10;
+
+template <typename T> void benchmark(const char *typeName, size_t n) {
+  notlab::Matrix<T> a = randomMatrix<T>(n);
+
+  notlab::LogDeterminant<notlab::lu_value_t<T>> logDeterminant{};
+  double luTime = secondsOf([&] { logDeterminant = notlab::logDeterminant(a); });
+
+  std::cout << typeName << " n=" << n << "  lu: " << luTime * 1e3 << " ms"
+            << "  sign*log|det|: " << logDeterminant.sign << "*"
+            << logDeterminant.logAbs;
+
+  if (n <= laplaceMaxSize) {
+    notlab::lu_value_t<T> fast = notlab::determinant(a);
+    notlab::lu_value_t<T> slow = 0;
+    double slowTime = secondsOf([&] { slow = notlab::determinantByLaplace(a); });
+    double relativeError =
+        std::abs(fast - slow) / std::max<double>(std::abs(slow), 1e-300);
+    std::cout << "  laplace: " << slowTime * 1e3 << " ms"
+              << "  speedup: " << slowTime / luTime
+              << "  relative error: " << relativeError;
+  }
+  std::cout << std::endl;
+}
+
+int main(int argc, char **argv) {
+  size_t maxSize = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 2000;
+  for (size_t n : {4, 6, 8, 10, 16, 64, 128, 256, 512, 1000, 2000}) {
+    if (n > maxSize) {
+      break;
+    }
+    benchmark<float>("float ", n);
+    benchmark<double>("double", n);
+  }
+  return 0;
+}
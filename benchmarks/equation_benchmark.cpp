@@ -0,0 +1,239 @@
+#include "equation.h"
+#include "equation_system.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+template <typename F> double secondsOf(F &&function) {
+  auto start = std::chrono::steady_clock::now();
+  function();
+  auto stop = std::chrono::steady_clock::now();
+  return std::chrono::duration<double>(stop - start).count();
+}
+
+// One sample at a time through the stack machine, the previous eval loop.
+notlab::VectorF evalPerSample(const notlab::Equation &equation,
+                              const notlab::VectorF &values) {
+  const notlab::Bytecode &bytecode = equation.getBytecode();
+  notlab::VectorF results = notlab::VectorF::zeros(values.getSize());
+  std::vector<float> stack(bytecode.getStackSize());
+  for (size_t i = 0; i < values.getSize(); i++) {
+    results.getRawData()[i] =
+        bytecode.run(values.getRawData() + i, stack.data());
+  }
+  return results;
+}
+
+// x runs over [-range, range).
+void benchmark(const std::string &formula, size_t samples,
+               float range = 10.0f) {
+  notlab::Equation equation(formula);
+  notlab::VectorF values = notlab::VectorF::zeros(samples);
+  for (size_t i = 0; i < samples; i++) {
+    values.getRawData()[i] = -range + 2 * range * i / samples;
+  }
+
+  notlab::VectorF slow = notlab::VectorF::zeros(0);
+  notlab::VectorF fast = notlab::VectorF::zeros(0);
+  double slowTime = secondsOf([&] { slow = evalPerSample(equation, values); });
+  double fastTime = secondsOf([&] { fast = equation.eval(values); });
+
+  double maxError = 0;
+  for (size_t i = 0; i < samples; i++) {
+    maxError = std::max<double>(
+        maxError, std::abs(fast.getRawData()[i] - slow.getRawData()[i]));
+  }
+
+  std::cout << formula << " on [" << -range << ", " << range
+            << ")  per sample: " << slowTime / samples * 1e9
+            << " ns  batch: " << fastTime / samples * 1e9
+            << " ns  speedup: " << slowTime / fastTime
+            << "  max difference: " << maxError << std::endl;
+}
+
+void benchmarkThreads(const std::string &formula, size_t samples) {
+  notlab::Equation equation(formula);
+  notlab::MatrixF values = notlab::MatrixF::zeros(samples, 2);
+  for (size_t i = 0; i < samples * 2; i++) {
+    values.getRawData()[i] = -10.0f + 20.0f * (i / 2) / samples;
+  }
+
+  notlab::VectorF serial = equation.eval(values);
+  double serialTime = secondsOf([&] { serial = equation.eval(values); });
+  std::cout << formula << "  threads: 1  " << serialTime * 1e3 << " ms"
+            << std::endl;
+
+  size_t hardwareThreads = std::max(1u, std::thread::hardware_concurrency());
+  for (size_t threads = 2; threads <= hardwareThreads; threads *= 2) {
+    equation.setNumberOfThreads(threads);
+    notlab::VectorF parallel = equation.eval(values);
+    double parallelTime =
+        secondsOf([&] { parallel = equation.eval(values); });
+    bool same = std::equal(serial.getRawData(),
+                           serial.getRawData() + samples, parallel.getRawData());
+    std::cout << formula << "  threads: " << threads << "  "
+              << parallelTime * 1e3 << " ms  speedup: "
+              << serialTime / parallelTime << (same ? "" : "  (MISMATCH)")
+              << std::endl;
+  }
+}
+
+void benchmarkGradient(const std::string &formula, size_t samples) {
+  notlab::Equation equation(formula);
+  size_t columns = equation.getVariables().size();
+  notlab::MatrixF values = notlab::MatrixF::zeros(samples, columns);
+  for (size_t i = 0; i < samples * columns; i++) {
+    values.getRawData()[i] = 0.1f + 2.0f * (i / columns) / samples;
+  }
+
+  notlab::VectorF plain = equation.eval(values);
+  double plainTime = secondsOf([&] { plain = equation.eval(values); });
+  notlab::MatrixF gradient = equation.evalWithGradient(values);
+  double symbolicTime =
+      secondsOf([&] { gradient = equation.evalWithGradient(values); });
+  equation.setGradientMode(notlab::GradientMode::Forward);
+  gradient = equation.evalWithGradient(values);
+  double forwardTime =
+      secondsOf([&] { gradient = equation.evalWithGradient(values); });
+
+  std::cout << formula << "  eval: " << plainTime * 1e3
+            << " ms  symbolic gradient: " << symbolicTime / plainTime
+            << "x  forward gradient: " << forwardTime / plainTime << "x"
+            << std::endl;
+}
+
+void benchmarkNative(const std::string &formula, size_t samples) {
+  notlab::Equation equation(formula);
+  size_t columns = equation.getVariables().size();
+  notlab::MatrixF values = notlab::MatrixF::zeros(samples, columns);
+  for (size_t i = 0; i < samples * columns; i++) {
+    values.getRawData()[i] = 0.1f + 20.0f * (i / columns) / samples;
+  }
+
+  // Reference for exactness: one sample at a time through Bytecode::run.
+  const notlab::Bytecode &bytecode = equation.getBytecode();
+  std::vector<float> reference(samples);
+  std::vector<float> stack(bytecode.getStackSize());
+  double perSampleTime = secondsOf([&] {
+    for (size_t i = 0; i < samples; i++) {
+      reference[i] =
+          bytecode.run(values.getRawData() + i * columns, stack.data());
+    }
+  });
+
+  notlab::VectorF batch = equation.eval(values);
+  double batchTime = secondsOf([&] { batch = equation.eval(values); });
+
+  double compileTime = secondsOf(
+      [&] { equation.setEvaluationMode(notlab::EvaluationMode::Native); });
+  notlab::VectorF native = equation.eval(values);
+  double nativeTime = secondsOf([&] { native = equation.eval(values); });
+  size_t mismatches = 0;
+  for (size_t i = 0; i < samples; i++) {
+    // Bitwise, NaN included.
+    mismatches += std::memcmp(&reference[i], native.getRawData() + i,
+                              sizeof(float)) != 0;
+  }
+
+  std::cout << formula << "  per sample: " << perSampleTime / samples * 1e9
+            << " ns  batch: " << batchTime / samples * 1e9
+            << " ns  native: " << nativeTime / samples * 1e9
+            << " ns  compile/load: " << compileTime * 1e3
+            << " ms  mismatches vs per sample: " << mismatches << std::endl;
+}
+
+void benchmarkDouble(const std::string &formula, size_t samples) {
+  notlab::Equation equation(formula);
+  notlab::VectorF floatValues = notlab::VectorF::zeros(samples);
+  notlab::VectorD doubleValues = notlab::VectorD::zeros(samples);
+  for (size_t i = 0; i < samples; i++) {
+    doubleValues.getRawData()[i] = 0.1 + 10.0 * i / samples;
+    floatValues.getRawData()[i] = static_cast<float>(doubleValues.getRawData()[i]);
+  }
+
+  notlab::VectorF floatResults = equation.eval(floatValues);
+  double floatTime =
+      secondsOf([&] { floatResults = equation.eval(floatValues); });
+  notlab::VectorD doubleResults = equation.eval(doubleValues);
+  double doubleTime =
+      secondsOf([&] { doubleResults = equation.eval(doubleValues); });
+
+  double maxDifference = 0;
+  for (size_t i = 0; i < samples; i++) {
+    maxDifference = std::max(maxDifference,
+                             std::abs(doubleResults.getRawData()[i] -
+                                      floatResults.getRawData()[i]));
+  }
+  std::cout << formula << "  float: " << floatTime / samples * 1e9
+            << " ns  double: " << doubleTime / samples * 1e9
+            << " ns  max float error: " << maxDifference << std::endl;
+}
+
+void benchmarkSystem(size_t numberOfOutputs, size_t samples) {
+  // Outputs share sin(x)*y and x^2/(1+y^2), like terms of one model.
+  std::vector<std::string> formulas;
+  for (size_t k = 0; k < numberOfOutputs; k++) {
+    formulas.push_back("sin(x)*y*" + std::to_string(k + 1) +
+                       "+x^2/(1+y^2)-" + std::to_string(k) + "*z");
+  }
+  notlab::MatrixF values = notlab::MatrixF::zeros(samples, 3);
+  for (size_t i = 0; i < samples * 3; i++) {
+    values.getRawData()[i] = 0.1f + 2.0f * (i / 3) / samples;
+  }
+
+  std::vector<notlab::Equation> equations;
+  for (const std::string &formula : formulas) {
+    equations.emplace_back(formula);
+  }
+  std::vector<notlab::VectorF> separate;
+  double separateTime = secondsOf([&] {
+    for (notlab::Equation &equation : equations) {
+      separate.push_back(equation.eval(values));
+    }
+  });
+
+  notlab::EquationSystem system(formulas);
+  notlab::MatrixF together = system.eval(values);
+  double systemTime = secondsOf([&] { together = system.eval(values); });
+
+  size_t mismatches = 0;
+  for (size_t i = 0; i < samples; i++) {
+    for (size_t k = 0; k < numberOfOutputs; k++) {
+      mismatches += together.getRawData()[i * numberOfOutputs + k] !=
+                    separate[k].getRawData()[i];
+    }
+  }
+  std::cout << numberOfOutputs << " outputs  separate equations: "
+            << separateTime * 1e3 << " ms  system: " << systemTime * 1e3
+            << " ms  speedup: " << separateTime / systemTime
+            << "  shared subexpressions: "
+            << system.getBytecode().getSharedSubexpressions().size()
+            << "  mismatches: " << mismatches << std::endl;
+}
+
+int main(int argc, char **argv) {
+  size_t samples = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 10000000;
+  benchmark("x*x+2*x-1", samples);
+  benchmark("sin(x)*10-x/3", samples);
+  // Mostly beyond simdSinMaxArgument, where vectors fall back to std::sin.
+  benchmark("sin(x)*10-x/3", samples, 100000.0f);
+  benchmark("3^2+1+max(sin(x),2)*10", samples);
+  benchmark("x^3/(1+x^2)+sin(-x)", samples);
+  benchmark("x^1.5+1", samples);
+  benchmarkThreads("sin(x)*y+x^3/(1+y^2)", samples);
+  benchmarkThreads("x^1.5+y^0.5", samples);
+  benchmarkGradient("sin(x)*y+x^3/(1+y^2)", samples);
+  benchmarkGradient("x*y^2+sin(x*y)-z/(1+x*x)", samples);
+  benchmarkNative("x*x+2*x-1", samples);
+  benchmarkNative("sin(x)*y+x^3/(1+y^2)", samples);
+  benchmarkNative("x*y^2+sin(x*y)-z/(1+x*x)+exp(-z)", samples);
+  benchmarkSystem(20, samples);
+  benchmarkDouble("x*x+2*x-1", samples);
+  benchmarkDouble("x^3/(1+x^2)+sin(x)*exp(-x)", samples);
+  return 0;
+}
@@ -0,0 +1,73 @@
+#include "matrix.h"
+
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+
+// Previous implementation of operator*, kept as the baseline.
+template <typename T>
+notlab::Matrix<T> naiveMultiply(const notlab::Matrix<T> &left,
+                                const notlab::Matrix<T> &right) {
+  notlab::Matrix<T> result = notlab::Matrix<T>::zeros(
+      left.getNumberOfRows(), right.getNumberOfColums());
+  for (size_t row = 1; row <= left.getNumberOfRows(); row++) {
+    for (size_t column = 1; column <= right.getNumberOfColums(); column++) {
+      T value = 0;
+      for (size_t k = 1; k <= left.getNumberOfColums(); k++) {
+        value += left(row, k) * right(k, column);
+      }
+      result(row, column) = value;
+    }
+  }
+  return result;
+}
+
+template <typename T> notlab::Matrix<T> randomMatrix(size_t n) {
+  std::mt19937 generator(42);
+  std::uniform_int_distribution<int> distribution(-4, 4);
+  notlab::Matrix<T> matrix = notlab::Matrix<T>::zeros(n, n);
+  T *data = matrix.getRawData();
+  for (size_t i = 0; i < n * n; i++) {
+    data[i] = static_cast<T>(distribution(generator));
+  }
+  return matrix;
+}
+
+template <typename F> double secondsOf(F &&function) {
+  auto start = std::chrono::steady_clock::now();
+  function();
+  auto stop = std::chrono::steady_clock::now();
+  return std::chrono::duration<double>(stop - start).count();
+}
+
+template <typename T> void benchmark(const char *typeName, size_t n) {
+  notlab::Matrix<T> a = randomMatrix<T>(n);
+  notlab::Matrix<T> b = randomMatrix<T>(n);
+  double flops = 2.0 * n * n * n;
+
+  notlab::Matrix<T> fast = notlab::Matrix<T>::empty();
+  double fastTime = secondsOf([&] { fast = a * b; });
+
+  std::cout << typeName << " n=" << n << "  gemm: " << flops / fastTime * 1e-9
+            << " GFLOP/s";
+
+  if (n <= 1024) {
+    notlab::Matrix<T> slow = notlab::Matrix<T>::empty();
+    double slowTime = secondsOf([&] { slow = naiveMultiply(a, b); });
+    std::cout << "  naive: " << flops / slowTime * 1e-9 << " GFLOP/s"
+              << "  speedup: " << slowTime / fastTime
+              << (notlab::isMatrixEqual(fast, slow) ? "" : "  (MISMATCH)");
+  }
+  std::cout << std::endl;
+}
+
+int main(int argc, char **argv) {
+  size_t maxSize = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 1024;
+  for (size_t n = 128; n <= maxSize; n *= 2) {
+    benchmark<int>("int   ", n);
+    benchmark<float>("float ", n);
+    benchmark<double>("double", n);
+  }
+  return 0;
+}
@@ -0,0 +1,115 @@
+#include "equation.h"
+
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+template <typename F> double secondsOf(F &&function) {
+  auto start = std::chrono::steady_clock::now();
+  function();
+  auto stop = std::chrono::steady_clock::now();
+  return std::chrono::duration<double>(stop - start).count();
+}
+
+// Random formula over x, y and z with about terms operators.
+std::string randomFormula(std::mt19937 &generator, size_t terms) {
+  const char *operands[] = {"x", "y", "z", "2.5", "10", "0.125"};
+  const char *operators[] = {"+", "-", "*", "/", "^"};
+  const char *functions[] = {"sin", "cos", "sqrt", "exp", "abs"};
+  std::uniform_int_distribution<size_t> pick(0, 1000);
+  std::string formula;
+  for (size_t i = 0; i < terms; i++) {
+    if (i > 0) {
+      formula += operators[pick(generator) % 5];
+    }
+    switch (pick(generator) % 4) {
+    case 0:
+      formula += std::string(functions[pick(generator) % 5]) + "(" +
+                 operands[pick(generator) % 6] + ")";
+      break;
+    case 1:
+      formula += std::string("(") + operands[pick(generator) % 6] + "+" +
+                 operands[pick(generator) % 6] + ")";
+      break;
+    case 2:
+      formula += std::string("max(") + operands[pick(generator) % 6] + "," +
+                 operands[pick(generator) % 6] + ")";
+      break;
+    default:
+      formula += operands[pick(generator) % 6];
+      break;
+    }
+  }
+  return formula;
+}
+
+void report(const char *stage, double seconds, size_t bytes, size_t formulas) {
+  std::cout << stage << ": " << bytes / seconds / 1e6 << " MB/s  "
+            << seconds / formulas * 1e6 << " us/formula" << std::endl;
+}
+
+int main(int argc, char **argv) {
+  size_t numberOfFormulas =
+      argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 20000;
+  std::mt19937 generator(42);
+  std::vector<std::string> formulas;
+  size_t bytes = 0;
+  for (size_t i = 0; i < numberOfFormulas; i++) {
+    formulas.push_back(randomFormula(generator, 4 + i % 12));
+    bytes += formulas.back().size();
+  }
+  std::cout << numberOfFormulas << " formulas, " << bytes / 1e6 << " MB"
+            << std::endl;
+
+  size_t numberOfTokens = 0;
+  double tokenizeTime = secondsOf([&] {
+    for (const std::string &formula : formulas) {
+      numberOfTokens += notlab::tokenize(formula).size();
+    }
+  });
+  report("tokenize", tokenizeTime, bytes, numberOfFormulas);
+
+  size_t arenaBytes = 0;
+  double parseTime = secondsOf([&] {
+    for (const std::string &formula : formulas) {
+      notlab::ExpressionArena arena;
+      notlab::parseTokens(notlab::tokenize(formula), arena);
+      arenaBytes += arena.getBytesUsed();
+    }
+  });
+  report("tokenize + parse", parseTime, bytes, numberOfFormulas);
+
+  size_t instructions = 0;
+  double equationTime = secondsOf([&] {
+    for (const std::string &formula : formulas) {
+      notlab::Equation equation(formula);
+      instructions += equation.getBytecode().getInstructions().size();
+    }
+  });
+  report("Equation (parse, optimize, compile)", equationTime, bytes,
+         numberOfFormulas);
+
+  // Same few hundred formulas over and over, answered by EquationCache.
+  size_t repeated = std::min<size_t>(numberOfFormulas, 300);
+  size_t repeatedBytes = 0;
+  notlab::EquationCache &cache = notlab::EquationCache::instance();
+  size_t hits = cache.getHits();
+  double cachedTime = secondsOf([&] {
+    for (size_t i = 0; i < numberOfFormulas; i++) {
+      notlab::Equation equation(formulas[i % repeated]);
+      repeatedBytes += formulas[i % repeated].size();
+    }
+  });
+  report("Equation (repeated formulas, cached)", cachedTime, repeatedBytes,
+         numberOfFormulas);
+  std::cout << "cache hits: " << cache.getHits() - hits
+            << "  misses: " << cache.getMisses() << std::endl;
+
+  std::cout << numberOfTokens << " tokens, " << arenaBytes / numberOfFormulas
+            << " arena bytes/formula, " << instructions << " instructions"
+            << std::endl;
+  return 0;
+}
@@ -0,0 +1,111 @@
+#pragma once
+
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "../equation_parser/arena.h"
+#include "../equation_parser/ast.h"
+#include "../equation_parser/tokenizer.h"
+#include "../equation_parser/parser.h"
+#include "../equation_parser/optimizer.h"
+#include "../equation_parser/derivative.h"
+#include "../equation_parser/bytecode.h"
+#include "../equation_parser/native.h"
+
+namespace notlab
+{
+    /**
+     * @class CompiledEquation
+     * @brief Parsed, optimized and compiled equation, shared by every Equation with the same formula.
+     * @details
+     *   Doesn't change after construction, so it can be used from many
+     *   threads without locking. The only exceptions are the gradient program
+     *   and the native program, each compiled once on first request.
+     */
+    class CompiledEquation{
+        private:
+            /// Owns every node of m_expression, declared first so it outlives the tree.
+            ExpressionArena m_arena;
+            Expression* m_expression = nullptr;
+            Bytecode m_bytecode;
+            std::vector<std::string> m_variables;
+            OptimizationReport m_optimizationReport;
+
+            mutable std::once_flag m_gradientOnce;
+            mutable std::optional<Bytecode> m_gradientBytecode;
+
+            mutable std::once_flag m_nativeOnce;
+            mutable std::optional<NativeProgram> m_nativeProgram;
+
+        public:
+            /**
+             * @brief Parses, optimizes and compiles equation.
+             *
+             * @param equationString Equation to parse.
+             * @param reportOptimizations Record folded constants, applied identities and shared subexpressions.
+             * @throws std::runtime_error on malformed equation.
+             */
+            CompiledEquation(std::string_view equationString, bool reportOptimizations){
+                std::vector<Token> tokens = tokenize(equationString);
+                appendVariables(tokens, m_variables);
+                OptimizationReport* report = reportOptimizations ? &m_optimizationReport : nullptr;
+                m_expression = optimizeExpression(parseTokens(tokens, m_arena), m_arena, report);
+                m_bytecode = Bytecode(*m_expression, m_variables);
+                if(report){
+                    for(const std::string& shared: m_bytecode.getSharedSubexpressions()){
+                        report->sharedSubexpressions++;
+                        report->changes.push_back("reused " + shared);
+                    }
+                }
+            }
+
+            /**
+             * @brief Symbolic derivative of source, keeps all variables of source in the same order.
+             */
+            CompiledEquation(const CompiledEquation& source, const std::string& variable)
+            : m_variables(source.m_variables){
+                m_expression = differentiateExpression(*source.m_expression, variable, m_arena);
+                m_bytecode = Bytecode(*m_expression, m_variables);
+            }
+
+            CompiledEquation(const CompiledEquation&) = delete;
+            CompiledEquation& operator=(const CompiledEquation&) = delete;
+
+            const Expression& getExpression() const { return *m_expression; }
+            const Bytecode& getBytecode() const { return m_bytecode; }
+            const std::vector<std::string>& getVariables() const { return m_variables; }
+            const OptimizationReport& getOptimizationReport() const { return m_optimizationReport; }
+
+            /**
+             * @brief Program computing value followed by partial derivatives in order of getVariables().
+             * @details Compiled on first call, later calls (from any thread) reuse it.
+             */
+            const Bytecode& getGradientBytecode() const {
+                std::call_once(m_gradientOnce, [this]{
+                    // Derivative trees are only needed until they are compiled.
+                    ExpressionArena derivativeArena;
+                    std::vector<const Expression*> outputs = {m_expression};
+                    for(const std::string& variable: m_variables){
+                        outputs.push_back(differentiateExpression(*m_expression, variable, derivativeArena));
+                    }
+                    m_gradientBytecode = Bytecode(outputs, m_variables);
+                });
+                return *m_gradientBytecode;
+            }
+
+            /**
+             * @brief getBytecode() compiled to machine code, see NativeProgram.
+             * @details Compiled (or loaded from disk cache) on first call, a failed attempt is retried by the next call.
+             * @throws std::runtime_error if compiler fails or library can't be loaded.
+             */
+            const NativeProgram& getNativeProgram() const {
+                std::call_once(m_nativeOnce, [this]{
+                    m_nativeProgram.emplace(m_bytecode);
+                });
+                return *m_nativeProgram;
+            }
+    };
+
+} // namespace notlab
@@ -1,41 +1,231 @@
 #pragma once
 
 #include <memory>
+#include <string>
 #include <vector>
-#include <set>
-#include "../equation_parser/ast.h"
-#include "../equation_parser/tokenizer.h"
-#include "../equation_parser/parser.h"
+#include <algorithm>
+#include <type_traits>
+#include "compiled_equation.h"
+#include "equation_cache.h"
 
 #include "vector.h"
 #include "matrix.h"
+#include "thread_pool.h"
 
 namespace notlab
 {
+    /**
+     * @brief How Equation::evalWithGradient computes derivatives.
+     */
+    enum class GradientMode{
+        /// Derivative expressions compiled together with equation, see Equation::derivative.
+        Symbolic,
+        /// Equation program run on dual numbers (value and one tangent per variable).
+        Forward
+    };
+
+    /**
+     * @brief How Equation::eval computes values.
+     */
+    enum class EvaluationMode{
+        /// Bytecode run by the stack machine.
+        Interpreted,
+        /**
+         * Bytecode compiled to machine code by system compiler, see NativeProgram.
+         * Results are bit-identical to Interpreted only if code evaluating
+         * equations is compiled without fma contraction (-ffp-contract=off
+         * with GCC and Clang), like the native library is.
+         */
+        Native
+    };
+
     class Equation{
         private:
-            std::unique_ptr<Expression> m_expression;
-            std::vector<Token> m_tokens;
+            /// Program shared with every Equation of the same formula.
+            std::shared_ptr<const CompiledEquation> m_compiled;
             std::string m_equationString;
 
-            std::vector<std::string> m_variables;
+            std::shared_ptr<ThreadPool> m_threadPool;
+            GradientMode m_gradientMode = GradientMode::Symbolic;
+            EvaluationMode m_evaluationMode = EvaluationMode::Interpreted;
 
-            void prepareVariables(){
-                std::set<std::string> found;
-                for(size_t i = 0; i < m_tokens.size(); i++){
-                    if(m_tokens[i].type == TokenType::Variable && found.insert(m_tokens[i].tokenContent).second){
-                        m_variables.push_back(m_tokens[i].tokenContent);
-                    }
+            /// Samples evaluated by one task of parallel evaluation.
+            static constexpr size_t s_parallelChunkSize = 16384;
+
+            /**
+             * @brief Runs body(from, to) over [0, count), split among threads when pool is set.
+             */
+            template<typename F>
+            void forEachChunk(size_t count, F&& body) const {
+                if(!m_threadPool){
+                    body(size_t(0), count);
+                    return;
                 }
+                m_threadPool->parallelFor(count, s_parallelChunkSize, body);
             }
 
+            /**
+             * @brief Evaluates count samples, variable v of sample i is values[i * stride + v].
+             */
+            template<typename T>
+            void evaluate(const Bytecode& bytecode, const T* values, size_t stride, size_t count, T* out) const {
+                size_t outputs = bytecode.getNumberOfOutputs();
+                forEachChunk(count, [&](size_t from, size_t to){
+                    bytecode.runBatch(values + from * stride, stride, to - from, out + from * outputs);
+                });
+            }
+
+            /**
+             * @brief Evaluates equation for count samples in current EvaluationMode, double is always interpreted.
+             */
+            template<typename T>
+            void evaluateValues(const T* values, size_t stride, size_t count, T* out) const {
+                if(m_evaluationMode == EvaluationMode::Interpreted || !std::is_same_v<T, float>){
+                    evaluate(m_compiled->getBytecode(), values, stride, count, out);
+                    return;
+                }
+                if constexpr (std::is_same_v<T, float>){
+                    const NativeProgram& program = m_compiled->getNativeProgram();
+                    forEachChunk(count, [&](size_t from, size_t to){
+                        program.run(values + from * stride, stride, to - from, out + from);
+                    });
+                }
+            }
+
+            /**
+             * @brief Evaluates value and gradient of count samples, 1 + number of variables outputs per sample.
+             */
+            void evaluateGradient(const float* values, size_t stride, size_t count, float* out) const {
+                if(m_gradientMode == GradientMode::Symbolic){
+                    evaluate(m_compiled->getGradientBytecode(), values, stride, count, out);
+                    return;
+                }
+                size_t outputs = 1 + m_compiled->getVariables().size();
+                forEachChunk(count, [&](size_t from, size_t to){
+                    m_compiled->getBytecode().runDualBatch(values + from * stride, stride, to - from, out + from * outputs);
+                });
+            }
+
+            Equation(std::shared_ptr<const CompiledEquation> compiled, std::string equationString)
+            : m_compiled(std::move(compiled)), m_equationString(std::move(equationString)){}
+
         public:
-            Equation(const std::string& equationString): m_equationString(equationString){
-                m_tokens = tokenize(m_equationString);
-                prepareVariables();
-                m_expression = std::move(parseTokens(m_tokens));
+            /**
+             * @brief Parses, optimizes and compiles equation.
+             * @details
+             *   Compiled program comes from EquationCache::instance(), so
+             *   constructing an equation seen before only looks it up.
+             *
+             * @param equationString Equation to parse.
+             * @param reportOptimizations Record folded constants, applied identities and shared subexpressions in getOptimizationReport().
+             */
+            Equation(const std::string& equationString, bool reportOptimizations = false)
+            : m_compiled(EquationCache::instance().get(equationString, reportOptimizations)), m_equationString(equationString){}
+
+            /**
+             * @brief Get names of variables, in order of their columns in eval(const MatrixF&).
+             */
+            const std::vector<std::string>& getVariables() const { return m_compiled->getVariables(); }
+
+            /**
+             * @brief Get compiled program of equation.
+             */
+            const Bytecode& getBytecode() const { return m_compiled->getBytecode(); }
+
+            /**
+             * @brief Get what optimization removed, empty unless constructed with reportOptimizations.
+             */
+            const OptimizationReport& getOptimizationReport() const { return m_compiled->getOptimizationReport(); }
+
+            /**
+             * @brief Symbolic derivative, simplified and compiled.
+             * @details Derivative keeps all variables of equation in the same order, even ones it no longer uses.
+             *
+             * @param variable Variable to differentiate with respect to.
+             * @return Equation Derivative.
+             */
+            Equation derivative(const std::string& variable) const {
+                auto compiled = std::make_shared<const CompiledEquation>(*m_compiled, variable);
+                std::string equationString = expressionToString(compiled->getExpression());
+                return Equation(std::move(compiled), std::move(equationString));
+            }
+
+            /**
+             * @brief Get program shared by all equations with this formula.
+             */
+            const std::shared_ptr<const CompiledEquation>& getCompiledEquation() const { return m_compiled; }
+
+            /**
+             * @brief Set number of threads used by eval of VectorF and MatrixF.
+             * @details Output doesn't depend on number of threads.
+             *
+             * @param numberOfThreads 1 evaluates on calling thread, 0 uses one thread per hardware thread.
+             */
+            void setNumberOfThreads(size_t numberOfThreads){
+                if(numberOfThreads == 1){
+                    m_threadPool.reset();
+                    return;
+                }
+                m_threadPool = std::make_shared<ThreadPool>(numberOfThreads);
+            }
+
+            /**
+             * @brief Use existing pool for parallel evaluation, pool can be shared by many equations.
+             *
+             * @param threadPool Pool to use, nullptr evaluates on calling thread.
+             */
+            void setThreadPool(std::shared_ptr<ThreadPool> threadPool){
+                m_threadPool = std::move(threadPool);
+            }
+
+            /**
+             * @brief Get number of threads used by eval of VectorF and MatrixF.
+             */
+            size_t getNumberOfThreads() const {
+                return m_threadPool ? m_threadPool->getNumberOfThreads() : 1;
+            }
+
+            /**
+             * @brief Set how evalWithGradient computes derivatives.
+             * @details
+             *   Symbolic compiles derivative expressions on first use, Forward
+             *   needs no compilation and its cost grows with number of variables.
+             *
+             * @param gradientMode Symbolic (default) or Forward.
+             */
+            void setGradientMode(GradientMode gradientMode){
+                m_gradientMode = gradientMode;
+            }
+
+            /**
+             * @brief Get how evalWithGradient computes derivatives.
+             */
+            GradientMode getGradientMode() const { return m_gradientMode; }
+
+            /**
+             * @brief Set how eval computes values.
+             * @details
+             *   Native compiles equation with system compiler on first use
+             *   (compiled libraries are cached on disk), afterwards eval runs
+             *   machine code. Results are bit-identical to Interpreted eval
+             *   when caller is compiled with -ffp-contract=off, see EvaluationMode::Native.
+             *   Gradients and double precision eval are always interpreted.
+             *
+             * @param evaluationMode Interpreted (default) or Native.
+             * @throws std::runtime_error if native compilation fails, mode is left unchanged then.
+             */
+            void setEvaluationMode(EvaluationMode evaluationMode){
+                if(evaluationMode == EvaluationMode::Native){
+                    m_compiled->getNativeProgram();
+                }
+                m_evaluationMode = evaluationMode;
             }
 
+            /**
+             * @brief Get how eval computes values.
+             */
+            EvaluationMode getEvaluationMode() const { return m_evaluationMode; }
+
             /**
              * @brief Evaluate equation with one variable and one value
              * 
@@ -43,12 +233,16 @@ namespace notlab
              * @return float Value evaluated
              */
             float eval(float variableValue){
-                if(m_variables.size() > 1){
+                if(m_compiled->getVariables().size() > 1){
                     throw std::runtime_error("Number of variables in equation is greater than 1");
                 }   
-                float val = m_expression->eval({{m_variables.back(), variableValue}});
-
-                return val;
+                if(m_evaluationMode == EvaluationMode::Native){
+                    float value;
+                    m_compiled->getNativeProgram().run(&variableValue, 1, 1, &value);
+                    return value;
+                }
+                std::vector<float> stack(m_compiled->getBytecode().getStackSize());
+                return m_compiled->getBytecode().run(&variableValue, stack.data());
             }
 
             /**
@@ -58,14 +252,11 @@ namespace notlab
              * @return VectorF Values evaluated
              */
             VectorF eval(const VectorF& variableValues){
-                if(m_variables.size() > 1){
+                if(m_compiled->getVariables().size() > 1){
                     throw std::runtime_error("Number of variables in equation is greater than 1");
                 }
-                std::string variableName = m_variables.back();
                 VectorF returnValues = VectorF::zeros(variableValues.getSize());
-                for(size_t i = 1; i<= variableValues.getSize(); i++){
-                    returnValues(i) = m_expression->eval({{variableName, variableValues(i)}});
-                }
+                evaluateValues(variableValues.getRawData(), 1, variableValues.getSize(), returnValues.getRawData());
                 return returnValues;
             }
 
@@ -76,23 +267,105 @@ namespace notlab
              * @return VectorF Values evaluated.
              */
             VectorF eval(const MatrixF& variablesValues){
-                if(variablesValues.getNumberOfColums() != m_variables.size()){
-                    std::string errorMsg("Number of given variables don't match up, expected: " + std::to_string((int)m_variables.size()));
+                if(variablesValues.getNumberOfColums() != m_compiled->getVariables().size()){
+                    std::string errorMsg("Number of given variables don't match up, expected: " + std::to_string((int)m_compiled->getVariables().size()));
                     throw std::runtime_error(errorMsg);
                 }
 
                 VectorF returnValues = VectorF::zeros(variablesValues.getNumberOfRows());
 
-                for(size_t i = 1; i <= variablesValues.getNumberOfRows(); i++){
-                    VectorF row = variablesValues.getRow(i);
-                    std::map<std::string, float> rowMap;
-                    for(size_t i = 1; i<= row.getSize(); i++){
-                        rowMap.insert(std::pair<std::string, float>(m_variables[i-1], row(i)));
-                    }
+                evaluateValues(variablesValues.getRawData(), variablesValues.getNumberOfColums(),
+                               variablesValues.getNumberOfRows(), returnValues.getRawData());
+
+                return returnValues;
+            }
+
+            /**
+             * @brief Evaluate equation with one variable and many values in double precision.
+             * @details Constants, arithmetic and built-in functions are computed in double, without converting input to float.
+             *
+             * @param variableValues Values to evaluate.
+             * @return VectorD Values evaluated.
+             */
+            VectorD eval(const VectorD& variableValues){
+                if(m_compiled->getVariables().size() > 1){
+                    throw std::runtime_error("Number of variables in equation is greater than 1");
+                }
+                VectorD returnValues = VectorD::zeros(variableValues.getSize());
+                evaluateValues(variableValues.getRawData(), 1, variableValues.getSize(), returnValues.getRawData());
+                return returnValues;
+            }
+
+            /**
+             * @brief Evaluate equation with many variables and many values in double precision.
+             *
+             * @param variablesValues Values to evaluate.
+             * @return VectorD Values evaluated.
+             */
+            VectorD eval(const MatrixD& variablesValues){
+                if(variablesValues.getNumberOfColums() != m_compiled->getVariables().size()){
+                    std::string errorMsg("Number of given variables don't match up, expected: " + std::to_string((int)m_compiled->getVariables().size()));
+                    throw std::runtime_error(errorMsg);
+                }
+                VectorD returnValues = VectorD::zeros(variablesValues.getNumberOfRows());
+                evaluateValues(variablesValues.getRawData(), variablesValues.getNumberOfColums(),
+                               variablesValues.getNumberOfRows(), returnValues.getRawData());
+                return returnValues;
+            }
 
-                    returnValues(i) = m_expression->eval(rowMap);
+            /**
+             * @brief Evaluate equation and its derivative with one variable and one value.
+             *
+             * @param variableValue Value to evaluate.
+             * @return VectorF (value, derivative).
+             */
+            VectorF evalWithGradient(float variableValue){
+                if(m_compiled->getVariables().size() > 1){
+                    throw std::runtime_error("Number of variables in equation is greater than 1");
+                }
+                VectorF returnValues = VectorF::zeros(1 + m_compiled->getVariables().size());
+                if(m_gradientMode == GradientMode::Forward){
+                    m_compiled->getBytecode().runDualBatch(&variableValue, 1, 1, returnValues.getRawData());
+                    return returnValues;
                 }
+                const Bytecode& bytecode = m_compiled->getGradientBytecode();
+                std::vector<float> stack(bytecode.getStackSize());
+                bytecode.run(&variableValue, stack.data(), returnValues.getRawData());
+                return returnValues;
+            }
 
+            /**
+             * @brief Evaluate equation and its derivative with one variable and many values, in one pass.
+             *
+             * @param variableValues Values to evaluate.
+             * @return MatrixF Row i is (value, derivative) at variableValues(i).
+             */
+            MatrixF evalWithGradient(const VectorF& variableValues){
+                if(m_compiled->getVariables().size() > 1){
+                    throw std::runtime_error("Number of variables in equation is greater than 1");
+                }
+                MatrixF returnValues = MatrixF::zeros(variableValues.getSize(), 1 + m_compiled->getVariables().size(), "gradient");
+                evaluateGradient(variableValues.getRawData(), 1, variableValues.getSize(), returnValues.getRawData());
+                return returnValues;
+            }
+
+            /**
+             * @brief Evaluate equation and its gradient with many variables and many values, in one pass.
+             * @details
+             *   Symbolic mode shares common subexpressions between value and partial
+             *   derivatives, Forward mode carries them all through one run of the equation.
+             *
+             * @param variablesValues Values to evaluate, one row per sample.
+             * @return MatrixF Row i is value followed by partial derivatives in order of getVariables().
+             */
+            MatrixF evalWithGradient(const MatrixF& variablesValues){
+                if(variablesValues.getNumberOfColums() != m_compiled->getVariables().size()){
+                    std::string errorMsg("Number of given variables don't match up, expected: " + std::to_string((int)m_compiled->getVariables().size()));
+                    throw std::runtime_error(errorMsg);
+                }
+                MatrixF returnValues = MatrixF::zeros(variablesValues.getNumberOfRows(), 1 + m_compiled->getVariables().size(), "gradient");
+                evaluateGradient(variablesValues.getRawData(), variablesValues.getNumberOfColums(),
+                                 variablesValues.getNumberOfRows(), returnValues.getRawData());
                 return returnValues;
             }
     };
@@ -0,0 +1,158 @@
+#pragma once
+
+#include <cctype>
+#include <cstddef>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include "compiled_equation.h"
+
+namespace notlab
+{
+    /**
+     * @class EquationCache
+     * @brief Bounded cache of compiled equations, least recently used entries are dropped first.
+     * @details
+     *   Keyed by normalized formula text, so formulas differing only in
+     *   spacing share one CompiledEquation. Entries are handed out as shared
+     *   pointers and stay alive while used, even after eviction. Safe to use
+     *   from many threads. A miss compiles without holding the lock.
+     */
+    class EquationCache{
+        private:
+            struct Entry{
+                std::string key;
+                std::shared_ptr<const CompiledEquation> compiled;
+            };
+
+            mutable std::mutex m_mutex;
+            /// Most recently used first.
+            std::list<Entry> m_entries;
+            /// Keys point into m_entries, list nodes don't move.
+            std::unordered_map<std::string_view, std::list<Entry>::iterator> m_index;
+            size_t m_capacity;
+            size_t m_hits = 0;
+            size_t m_misses = 0;
+            size_t m_evictions = 0;
+
+            void evictOverCapacity(){
+                while(m_entries.size() > m_capacity){
+                    m_index.erase(m_entries.back().key);
+                    m_entries.pop_back();
+                    m_evictions++;
+                }
+            }
+
+        public:
+            /**
+             * @brief Creates cache.
+             * @param capacity Largest number of kept equations, 0 disables caching.
+             */
+            explicit EquationCache(size_t capacity = 1024): m_capacity(capacity) {}
+
+            EquationCache(const EquationCache&) = delete;
+            EquationCache& operator=(const EquationCache&) = delete;
+
+            /**
+             * @brief Cache used by Equation constructor.
+             */
+            static EquationCache& instance(){
+                static EquationCache inst;
+                return inst;
+            }
+
+            /**
+             * @brief Formula without whitespace, except single space where removing it would join two names or numbers.
+             * @details Space between name and '(' is kept too, "sin (x)" is variable sin times (x), not a call.
+             */
+            static std::string normalize(std::string_view formula){
+                auto isWordCharacter = [](char c){ return std::isalnum(static_cast<unsigned char>(c)) || c == '.'; };
+                std::string normalized;
+                normalized.reserve(formula.size());
+                bool pendingSpace = false;
+                for(char c: formula){
+                    if(std::isspace(static_cast<unsigned char>(c))){
+                        pendingSpace = true;
+                        continue;
+                    }
+                    if(pendingSpace && !normalized.empty() && isWordCharacter(normalized.back()) && (isWordCharacter(c) || c == '(')){
+                        normalized += ' ';
+                    }
+                    pendingSpace = false;
+                    normalized += c;
+                }
+                return normalized;
+            }
+
+            /**
+             * @brief Compiled equation for formula, compiled and stored on miss.
+             *
+             * @param formula Equation to parse.
+             * @param reportOptimizations Whether compiled equation records an OptimizationReport, part of key.
+             * @throws std::runtime_error on malformed equation, nothing is stored then.
+             * @return std::shared_ptr<const CompiledEquation> Shared compiled equation.
+             */
+            std::shared_ptr<const CompiledEquation> get(std::string_view formula, bool reportOptimizations = false){
+                std::string key = normalize(formula);
+                key += reportOptimizations ? "#report" : "#";
+                {
+                    std::lock_guard<std::mutex> lock(m_mutex);
+                    auto it = m_index.find(key);
+                    if(it != m_index.end()){
+                        m_hits++;
+                        m_entries.splice(m_entries.begin(), m_entries, it->second);
+                        return it->second->compiled;
+                    }
+                    m_misses++;
+                }
+
+                auto compiled = std::make_shared<const CompiledEquation>(formula, reportOptimizations);
+
+                std::lock_guard<std::mutex> lock(m_mutex);
+                if(m_capacity == 0){
+                    return compiled;
+                }
+                auto it = m_index.find(key);
+                if(it != m_index.end()){
+                    // Another thread compiled same formula meanwhile.
+                    m_entries.splice(m_entries.begin(), m_entries, it->second);
+                    return it->second->compiled;
+                }
+                m_entries.push_front({std::move(key), compiled});
+                m_index.emplace(m_entries.front().key, m_entries.begin());
+                evictOverCapacity();
+                return compiled;
+            }
+
+            /**
+             * @brief Change largest number of kept equations, dropping least recently used ones if needed.
+             */
+            void setCapacity(size_t capacity){
+                std::lock_guard<std::mutex> lock(m_mutex);
+                m_capacity = capacity;
+                evictOverCapacity();
+            }
+
+            /**
+             * @brief Drop all entries, counters are kept.
+             */
+            void clear(){
+                std::lock_guard<std::mutex> lock(m_mutex);
+                m_index.clear();
+                m_entries.clear();
+            }
+
+            size_t getCapacity() const { std::lock_guard<std::mutex> lock(m_mutex); return m_capacity; }
+            size_t getSize() const { std::lock_guard<std::mutex> lock(m_mutex); return m_entries.size(); }
+            /// Lookups answered from cache.
+            size_t getHits() const { std::lock_guard<std::mutex> lock(m_mutex); return m_hits; }
+            /// Lookups that had to compile.
+            size_t getMisses() const { std::lock_guard<std::mutex> lock(m_mutex); return m_misses; }
+            /// Entries dropped because cache was full.
+            size_t getEvictions() const { std::lock_guard<std::mutex> lock(m_mutex); return m_evictions; }
+    };
+
+} // namespace notlab
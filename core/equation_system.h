@@ -0,0 +1,242 @@
+#pragma once
+
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <type_traits>
+#include <vector>
+#include "../equation_parser/arena.h"
+#include "../equation_parser/ast.h"
+#include "../equation_parser/tokenizer.h"
+#include "../equation_parser/parser.h"
+#include "../equation_parser/optimizer.h"
+#include "../equation_parser/bytecode.h"
+#include "../equation_parser/native.h"
+
+#include "equation.h"
+#include "vector.h"
+#include "matrix.h"
+#include "thread_pool.h"
+
+namespace notlab
+{
+    /**
+     * @class EquationSystem
+     * @brief Several equations over the same variables, evaluated together.
+     * @details
+     *   All equations are compiled into one Bytecode with one output per
+     *   equation, so subexpressions common to several equations are
+     *   computed once per sample and every input row is read once, no
+     *   matter how many outputs there are.
+     */
+    class EquationSystem{
+        private:
+            ExpressionArena m_arena;
+            std::vector<std::string> m_equationStrings;
+            std::vector<const Expression*> m_expressions;
+            std::vector<std::string> m_variables;
+            Bytecode m_bytecode;
+            OptimizationReport m_optimizationReport;
+
+            std::shared_ptr<ThreadPool> m_threadPool;
+            EvaluationMode m_evaluationMode = EvaluationMode::Interpreted;
+            mutable std::once_flag m_nativeOnce;
+            mutable std::optional<NativeProgram> m_nativeProgram;
+
+            /// Samples evaluated by one task of parallel evaluation.
+            static constexpr size_t s_parallelChunkSize = 16384;
+
+            const NativeProgram& getNativeProgram() const {
+                std::call_once(m_nativeOnce, [this]{
+                    m_nativeProgram.emplace(m_bytecode);
+                });
+                return *m_nativeProgram;
+            }
+
+            /**
+             * @brief Evaluates count samples, variable v of sample i is values[i * stride + v].
+             */
+            template<typename T>
+            void evaluate(const T* values, size_t stride, size_t count, T* out) const {
+                size_t outputs = m_bytecode.getNumberOfOutputs();
+                auto body = [&](size_t from, size_t to){
+                    if constexpr (std::is_same_v<T, float>){
+                        if(m_evaluationMode == EvaluationMode::Native){
+                            getNativeProgram().run(values + from * stride, stride, to - from, out + from * outputs);
+                            return;
+                        }
+                    }
+                    m_bytecode.runBatch(values + from * stride, stride, to - from, out + from * outputs);
+                };
+                if(!m_threadPool){
+                    body(size_t(0), count);
+                    return;
+                }
+                m_threadPool->parallelFor(count, s_parallelChunkSize, body);
+            }
+
+            void compile(const std::vector<std::string>& equationStrings, bool collectVariables, bool reportOptimizations){
+                if(equationStrings.empty()){
+                    throw std::runtime_error("Equation system is empty");
+                }
+                OptimizationReport* report = reportOptimizations ? &m_optimizationReport : nullptr;
+                for(size_t k = 0; k < equationStrings.size(); k++){
+                    try{
+                        std::vector<Token> tokens = tokenize(equationStrings[k]);
+                        if(collectVariables){
+                            appendVariables(tokens, m_variables);
+                        }
+                        m_expressions.push_back(optimizeExpression(parseTokens(tokens, m_arena), m_arena, report));
+                    }
+                    catch(const std::runtime_error& error){
+                        throw std::runtime_error("Equation " + std::to_string(k) + ": " + error.what());
+                    }
+                }
+                m_bytecode = Bytecode(m_expressions, m_variables);
+                if(report){
+                    for(const std::string& shared: m_bytecode.getSharedSubexpressions()){
+                        report->sharedSubexpressions++;
+                        report->changes.push_back("reused " + shared);
+                    }
+                }
+            }
+
+        public:
+            /**
+             * @brief Parses, optimizes and compiles equations together.
+             * @details Variables are ordered by first occurrence, going through equations in order.
+             *
+             * @param equationStrings Equations, output k is equationStrings[k].
+             * @param reportOptimizations Record folded constants, applied identities and shared subexpressions in getOptimizationReport().
+             * @throws std::runtime_error on malformed equation, message starts with its index.
+             */
+            EquationSystem(const std::vector<std::string>& equationStrings, bool reportOptimizations = false)
+            : m_equationStrings(equationStrings){
+                compile(equationStrings, true, reportOptimizations);
+            }
+
+            /**
+             * @brief Parses, optimizes and compiles equations over given variables.
+             *
+             * @param equationStrings Equations, output k is equationStrings[k].
+             * @param variables Columns of input matrix, equations may use any subset of them.
+             * @param reportOptimizations Record folded constants, applied identities and shared subexpressions in getOptimizationReport().
+             * @throws std::runtime_error on malformed equation or variable missing from variables.
+             */
+            EquationSystem(const std::vector<std::string>& equationStrings, const std::vector<std::string>& variables,
+                           bool reportOptimizations = false)
+            : m_equationStrings(equationStrings), m_variables(variables){
+                compile(equationStrings, false, reportOptimizations);
+            }
+
+            EquationSystem(const EquationSystem&) = delete;
+            EquationSystem& operator=(const EquationSystem&) = delete;
+
+            /**
+             * @brief Get names of variables, in order of columns of input matrix.
+             */
+            const std::vector<std::string>& getVariables() const { return m_variables; }
+
+            /**
+             * @brief Get equations, in order of output columns.
+             */
+            const std::vector<std::string>& getEquations() const { return m_equationStrings; }
+
+            /**
+             * @brief Get number of equations, which is number of output columns.
+             */
+            size_t getNumberOfOutputs() const { return m_bytecode.getNumberOfOutputs(); }
+
+            /**
+             * @brief Get program computing all equations.
+             */
+            const Bytecode& getBytecode() const { return m_bytecode; }
+
+            /**
+             * @brief Get what optimization removed and which subexpressions are shared, empty unless constructed with reportOptimizations.
+             */
+            const OptimizationReport& getOptimizationReport() const { return m_optimizationReport; }
+
+            /**
+             * @brief Set number of threads used by eval, see Equation::setNumberOfThreads.
+             */
+            void setNumberOfThreads(size_t numberOfThreads){
+                if(numberOfThreads == 1){
+                    m_threadPool.reset();
+                    return;
+                }
+                m_threadPool = std::make_shared<ThreadPool>(numberOfThreads);
+            }
+
+            /**
+             * @brief Use existing pool for parallel evaluation, nullptr evaluates on calling thread.
+             */
+            void setThreadPool(std::shared_ptr<ThreadPool> threadPool){
+                m_threadPool = std::move(threadPool);
+            }
+
+            /**
+             * @brief Set how eval computes values, see Equation::setEvaluationMode.
+             * @throws std::runtime_error if native compilation fails, mode is left unchanged then.
+             */
+            void setEvaluationMode(EvaluationMode evaluationMode){
+                if(evaluationMode == EvaluationMode::Native){
+                    getNativeProgram();
+                }
+                m_evaluationMode = evaluationMode;
+            }
+
+            EvaluationMode getEvaluationMode() const { return m_evaluationMode; }
+
+            /**
+             * @brief Evaluate all equations with one variable and many values.
+             *
+             * @param variableValues Values to evaluate.
+             * @return MatrixF Row i holds every equation at variableValues(i).
+             */
+            MatrixF eval(const VectorF& variableValues) const {
+                if(m_variables.size() > 1){
+                    throw std::runtime_error("Number of variables in equation system is greater than 1");
+                }
+                MatrixF returnValues = MatrixF::zeros(variableValues.getSize(), getNumberOfOutputs(), "outputs");
+                evaluate(variableValues.getRawData(), 1, variableValues.getSize(), returnValues.getRawData());
+                return returnValues;
+            }
+
+            /**
+             * @brief Evaluate all equations with many variables and many values, in one pass over input.
+             *
+             * @param variablesValues Values to evaluate, one row per sample, columns in order of getVariables().
+             * @return MatrixF Rows x getNumberOfOutputs(), column k is equation k.
+             */
+            MatrixF eval(const MatrixF& variablesValues) const {
+                if(variablesValues.getNumberOfColums() != m_variables.size()){
+                    std::string errorMsg("Number of given variables don't match up, expected: " + std::to_string((int)m_variables.size()));
+                    throw std::runtime_error(errorMsg);
+                }
+                MatrixF returnValues = MatrixF::zeros(variablesValues.getNumberOfRows(), getNumberOfOutputs(), "outputs");
+                evaluate(variablesValues.getRawData(), variablesValues.getNumberOfColums(),
+                         variablesValues.getNumberOfRows(), returnValues.getRawData());
+                return returnValues;
+            }
+
+            /**
+             * @brief Evaluate all equations in double precision, see Equation::eval(const MatrixD&).
+             *
+             * @param variablesValues Values to evaluate, one row per sample, columns in order of getVariables().
+             * @return MatrixD Rows x getNumberOfOutputs(), column k is equation k.
+             */
+            MatrixD eval(const MatrixD& variablesValues) const {
+                if(variablesValues.getNumberOfColums() != m_variables.size()){
+                    std::string errorMsg("Number of given variables don't match up, expected: " + std::to_string((int)m_variables.size()));
+                    throw std::runtime_error(errorMsg);
+                }
+                MatrixD returnValues = MatrixD::zeros(variablesValues.getNumberOfRows(), getNumberOfOutputs(), "outputs");
+                evaluate(variablesValues.getRawData(), variablesValues.getNumberOfColums(),
+                         variablesValues.getNumberOfRows(), returnValues.getRawData());
+                return returnValues;
+            }
+    };
+
+} // namespace notlab
@@ -0,0 +1,196 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <vector>
+
+namespace notlab {
+
+/**
+ * @struct gemm_block_sizes
+ * @brief Blocking parameters of the matrix multiplication kernel.
+ * @details
+ *   MR x NR is the register tile computed by the micro-kernel, MC x KC is the
+ *   packed block of the left operand (sized to stay in L2), KC x NC is the
+ *   packed panel of the right operand (sized to stay in L3) and a KC x NR
+ *   sliver of it stays in L1 while the micro-kernel runs.
+ * @tparam T Element type of the multiplication.
+ */
+template <typename T> struct gemm_block_sizes {};
+
+/// Specialization: int, 4x8 tile of 32-bit accumulators.
+template <> struct gemm_block_sizes<int> {
+  static constexpr size_t MR = 4;
+  static constexpr size_t NR = 8;
+  static constexpr size_t MC = 128;
+  static constexpr size_t KC = 256;
+  static constexpr size_t NC = 2048;
+};
+/// Specialization: float, 4x8 tile of single precision accumulators.
+template <> struct gemm_block_sizes<float> {
+  static constexpr size_t MR = 4;
+  static constexpr size_t NR = 8;
+  static constexpr size_t MC = 128;
+  static constexpr size_t KC = 256;
+  static constexpr size_t NC = 2048;
+};
+/// Specialization: double, 4x4 tile of double precision accumulators.
+template <> struct gemm_block_sizes<double> {
+  static constexpr size_t MR = 4;
+  static constexpr size_t NR = 4;
+  static constexpr size_t MC = 96;
+  static constexpr size_t KC = 256;
+  static constexpr size_t NC = 1024;
+};
+
+/**
+ * @brief Packs mc x kc block of A into row panels of MR rows.
+ * @details
+ *   Panel p holds rows [p*MR, p*MR + MR) stored column after column, so the
+ *   micro-kernel reads A with unit stride. Missing rows are padded with zeros.
+ */
+template <typename T, typename A>
+void gemmPackA(size_t mc, size_t kc, const A *a, size_t lda, T *packed) {
+  constexpr size_t MR = gemm_block_sizes<T>::MR;
+  for (size_t i = 0; i < mc; i += MR) {
+    size_t rows = std::min(MR, mc - i);
+    for (size_t p = 0; p < kc; p++) {
+      for (size_t r = 0; r < rows; r++) {
+        packed[r] = static_cast<T>(a[(i + r) * lda + p]);
+      }
+      for (size_t r = rows; r < MR; r++) {
+        packed[r] = T(0);
+      }
+      packed += MR;
+    }
+  }
+}
+
+/**
+ * @brief Packs kc x nc panel of B into column panels of NR columns.
+ * @details
+ *   Panel q holds columns [q*NR, q*NR + NR) stored row after row, so the
+ *   micro-kernel reads B with unit stride. Missing columns are padded with
+ *   zeros.
+ */
+template <typename T, typename B>
+void gemmPackB(size_t kc, size_t nc, const B *b, size_t ldb, T *packed) {
+  constexpr size_t NR = gemm_block_sizes<T>::NR;
+  for (size_t j = 0; j < nc; j += NR) {
+    size_t cols = std::min(NR, nc - j);
+    for (size_t p = 0; p < kc; p++) {
+      const B *row = b + p * ldb + j;
+      for (size_t c = 0; c < cols; c++) {
+        packed[c] = static_cast<T>(row[c]);
+      }
+      for (size_t c = cols; c < NR; c++) {
+        packed[c] = T(0);
+      }
+      packed += NR;
+    }
+  }
+}
+
+/**
+ * @brief Computes one MR x NR tile: C += alpha * Apanel * Bpanel.
+ * @details
+ *   Accumulators live in a fixed-size local array that the compiler keeps in
+ *   vector registers. Only the valid mr x nr part is written back.
+ */
+template <typename T>
+void gemmMicroKernel(size_t kc, const T *a, const T *b, T *c, size_t ldc,
+                     size_t mr, size_t nr, T alpha) {
+  constexpr size_t MR = gemm_block_sizes<T>::MR;
+  constexpr size_t NR = gemm_block_sizes<T>::NR;
+
+  T accumulator[MR][NR] = {};
+  for (size_t p = 0; p < kc; p++) {
+    for (size_t i = 0; i < MR; i++) {
+      T aValue = a[i];
+      for (size_t j = 0; j < NR; j++) {
+        accumulator[i][j] += aValue * b[j];
+      }
+    }
+    a += MR;
+    b += NR;
+  }
+
+  for (size_t i = 0; i < mr; i++) {
+    for (size_t j = 0; j < nr; j++) {
+      c[i * ldc + j] += alpha * accumulator[i][j];
+    }
+  }
+}
+
+/**
+ * @brief General matrix multiplication C += alpha * A * B on row-major data.
+ * @details
+ *   Small products go through a plain i-k-j loop. Larger products are split
+ *   into KC x NC panels of B and MC x KC blocks of A, both packed into
+ *   contiguous buffers and multiplied tile by tile by gemmMicroKernel.
+ *   Operands are converted to T while packing.
+ * @tparam T Type of the result (int, float or double).
+ * @param m Number of rows of A and C.
+ * @param n Number of columns of B and C.
+ * @param k Number of columns of A and rows of B.
+ * @param a Pointer to A, row stride lda.
+ * @param b Pointer to B, row stride ldb.
+ * @param c Pointer to C, row stride ldc.
+ * @param alpha Scale factor of the product.
+ */
+template <typename T, typename A, typename B>
+void gemm(size_t m, size_t n, size_t k, const A *a, size_t lda, const B *b,
+          size_t ldb, T *c, size_t ldc, T alpha = T(1)) {
+  using sizes = gemm_block_sizes<T>;
+  constexpr size_t MR = sizes::MR;
+  constexpr size_t NR = sizes::NR;
+
+  if (m == 0 || n == 0 || k == 0) {
+    return;
+  }
+
+  if (m * n * k <= 32 * 32 * 32) {
+    for (size_t i = 0; i < m; i++) {
+      T *cRow = c + i * ldc;
+      for (size_t p = 0; p < k; p++) {
+        T aValue = alpha * static_cast<T>(a[i * lda + p]);
+        const B *bRow = b + p * ldb;
+        for (size_t j = 0; j < n; j++) {
+          cRow[j] += aValue * static_cast<T>(bRow[j]);
+        }
+      }
+    }
+    return;
+  }
+
+  size_t ncMax = std::min(sizes::NC, (n + NR - 1) / NR * NR);
+  size_t kcMax = std::min(sizes::KC, k);
+  size_t mcMax = std::min(sizes::MC, (m + MR - 1) / MR * MR);
+  std::vector<T> packedA(mcMax * kcMax);
+  std::vector<T> packedB(kcMax * ncMax);
+
+  for (size_t jc = 0; jc < n; jc += sizes::NC) {
+    size_t nc = std::min(sizes::NC, n - jc);
+    for (size_t pc = 0; pc < k; pc += sizes::KC) {
+      size_t kc = std::min(sizes::KC, k - pc);
+      gemmPackB(kc, nc, b + pc * ldb + jc, ldb, packedB.data());
+
+      for (size_t ic = 0; ic < m; ic += sizes::MC) {
+        size_t mc = std::min(sizes::MC, m - ic);
+        gemmPackA(mc, kc, a + ic * lda + pc, lda, packedA.data());
+
+        for (size_t jr = 0; jr < nc; jr += NR) {
+          size_t nr = std::min(NR, nc - jr);
+          const T *bPanel = packedB.data() + jr * kc;
+          for (size_t ir = 0; ir < mc; ir += MR) {
+            size_t mr = std::min(MR, mc - ir);
+            gemmMicroKernel(kc, packedA.data() + ir * kc, bPanel,
+                            c + (ic + ir) * ldc + jc + jr, ldc, mr, nr, alpha);
+          }
+        }
+      }
+    }
+  }
+}
+
+} // namespace notlab
@@ -0,0 +1,331 @@
+#pragma once
+
+#include "simd.h"
+#include <functional>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <utility>
+
+namespace notlab {
+
+template <typename T> class Matrix;
+template <typename T> class Vector;
+
+/**
+ * @brief Kind of container a lazy expression evaluates to.
+ */
+enum class ExpressionKind { Matrix, Vector };
+
+/**
+ * @struct is_lazy_expression
+ * @brief Type trait marking lazy expression nodes.
+ * @tparam E Type to check.
+ */
+template <typename E> struct is_lazy_expression : std::false_type {};
+
+/**
+ * @struct MatrixLeaf
+ * @brief Lazy expression leaf referencing an existing Matrix.
+ * @tparam T Element type of the Matrix.
+ */
+template <typename T> struct MatrixLeaf {
+  using value_type = T;
+  static constexpr ExpressionKind kind = ExpressionKind::Matrix;
+
+  const Matrix<T> &matrix;
+  const T *data;
+
+  explicit MatrixLeaf(const Matrix<T> &m) : matrix(m), data(m.getRawData()) {}
+
+  size_t rows() const { return matrix.getNumberOfRows(); }
+  size_t cols() const { return matrix.getNumberOfColums(); }
+  size_t size() const { return matrix.getNumberOfElements(); }
+  T at(size_t index) const { return data[index]; }
+  std::string name() const { return matrix.getName(); }
+};
+
+/**
+ * @struct VectorLeaf
+ * @brief Lazy expression leaf referencing an existing Vector.
+ * @tparam T Element type of the Vector.
+ */
+template <typename T> struct VectorLeaf {
+  using value_type = T;
+  static constexpr ExpressionKind kind = ExpressionKind::Vector;
+
+  const T *data;
+  size_t length;
+
+  explicit VectorLeaf(const Vector<T> &v)
+      : data(v.getRawData()), length(v.getSize()) {}
+
+  size_t rows() const { return length; }
+  size_t cols() const { return 1; }
+  size_t size() const { return length; }
+  T at(size_t index) const { return data[index]; }
+  std::string name() const { return ""; }
+};
+
+/// Symbol and instruction name of operator used by lazy expressions.
+template <typename Op> struct lazy_operator_info {};
+template <> struct lazy_operator_info<std::plus<>> {
+  static constexpr const char *symbol = "+";
+  static constexpr const char *instruction = "Addition";
+};
+template <> struct lazy_operator_info<std::minus<>> {
+  static constexpr const char *symbol = "-";
+  static constexpr const char *instruction = "Subtraction";
+};
+template <> struct lazy_operator_info<std::multiplies<>> {
+  static constexpr const char *symbol = "*";
+  static constexpr const char *instruction = "Multiplication";
+};
+template <> struct lazy_operator_info<std::divides<>> {
+  static constexpr const char *symbol = "/";
+  static constexpr const char *instruction = "Division";
+};
+
+/**
+ * @struct LazyBinary
+ * @brief Elementwise operation of two lazy operands.
+ * @details
+ *   Sub-expressions are stored by value, leaves only reference their
+ *   container. Nothing is computed until the expression is assigned to a
+ *   Matrix or Vector, so containers used in an expression must outlive it.
+ */
+template <typename L, typename R, typename Op> struct LazyBinary {
+  using value_type = decltype(Op()(typename L::value_type(),
+                                   typename R::value_type()));
+  static constexpr ExpressionKind kind = L::kind;
+  static_assert(L::kind == R::kind,
+                "Can't mix Matrix and Vector in one expression");
+
+  L left;
+  R right;
+
+  LazyBinary(const L &l, const R &r) : left(l), right(r) {
+    if (left.rows() != right.rows() || left.cols() != right.cols()) {
+      if (kind == ExpressionKind::Vector) {
+        throw std::runtime_error("Length of vectors don't match");
+      }
+      throw std::runtime_error("Numbers of columns or rows don't match up");
+    }
+  }
+
+  size_t rows() const { return left.rows(); }
+  size_t cols() const { return left.cols(); }
+  size_t size() const { return left.size(); }
+  value_type at(size_t index) const {
+    return Op()(static_cast<value_type>(left.at(index)),
+                static_cast<value_type>(right.at(index)));
+  }
+  std::string name() const {
+    return left.name() + lazy_operator_info<Op>::symbol + right.name();
+  }
+  std::string instruction() const { return lazy_operator_info<Op>::instruction; }
+};
+
+/**
+ * @struct LazyScalar
+ * @brief Operation of lazy operand with a scalar (multiply or divide).
+ */
+template <typename E, typename S, typename Op> struct LazyScalar {
+  using value_type = decltype(typename E::value_type() * S());
+  static constexpr ExpressionKind kind = E::kind;
+
+  E expression;
+  S scalar;
+
+  LazyScalar(const E &e, const S &s) : expression(e), scalar(s) {}
+
+  size_t rows() const { return expression.rows(); }
+  size_t cols() const { return expression.cols(); }
+  size_t size() const { return expression.size(); }
+  value_type at(size_t index) const {
+    return Op()(expression.at(index), scalar);
+  }
+  std::string name() const { return expression.name(); }
+  std::string instruction() const { return lazy_operator_info<Op>::instruction; }
+};
+
+template <typename L, typename R, typename Op>
+struct is_lazy_expression<LazyBinary<L, R, Op>> : std::true_type {};
+template <typename E, typename S, typename Op>
+struct is_lazy_expression<LazyScalar<E, S, Op>> : std::true_type {};
+
+/**
+ * @brief Wraps container or expression as lazy operand.
+ */
+template <typename T> MatrixLeaf<T> toLazyOperand(const Matrix<T> &matrix) {
+  return MatrixLeaf<T>(matrix);
+}
+template <typename T> VectorLeaf<T> toLazyOperand(const Vector<T> &vector) {
+  return VectorLeaf<T>(vector);
+}
+template <typename E>
+  requires is_lazy_expression<E>::value
+const E &toLazyOperand(const E &expression) {
+  return expression;
+}
+
+template <typename X>
+using lazy_operand_t =
+    std::decay_t<decltype(toLazyOperand(std::declval<const X &>()))>;
+
+template <typename X> struct is_lazy_operand : is_lazy_expression<X> {};
+template <typename T> struct is_lazy_operand<Matrix<T>> : std::true_type {};
+template <typename T> struct is_lazy_operand<Vector<T>> : std::true_type {};
+
+template <typename L, typename R>
+concept lazy_operands = is_lazy_operand<L>::value && is_lazy_operand<R>::value;
+
+template <typename E, typename S>
+concept lazy_scalar_operands =
+    is_lazy_operand<E>::value && std::is_arithmetic_v<S>;
+
+template <typename E> struct is_lazy_leaf : std::false_type {};
+template <typename T> struct is_lazy_leaf<MatrixLeaf<T>> : std::true_type {};
+template <typename T> struct is_lazy_leaf<VectorLeaf<T>> : std::true_type {};
+
+/// Expressions that map directly onto one kernel from simd.h.
+template <typename E> struct has_lazy_kernel : std::false_type {};
+template <typename L, typename R, typename Op>
+struct has_lazy_kernel<LazyBinary<L, R, Op>>
+    : std::bool_constant<is_lazy_leaf<L>::value && is_lazy_leaf<R>::value> {};
+template <typename E, typename S>
+struct has_lazy_kernel<LazyScalar<E, S, std::multiplies<>>>
+    : is_lazy_leaf<E> {};
+
+template <typename Out, typename L, typename R, typename Op>
+void lazyKernel(const LazyBinary<L, R, Op> &expression, Out *out) {
+  elementwiseKernel(expression.left.data, expression.right.data, out,
+                    expression.size(), Op());
+}
+
+template <typename Out, typename E, typename S>
+void lazyKernel(const LazyScalar<E, S, std::multiplies<>> &expression,
+                Out *out) {
+  scaleKernel(expression.expression.data, expression.scalar, out,
+              expression.size());
+}
+
+/**
+ * @brief Evaluates expression into contiguous storage in one pass.
+ * @details
+ *   A single operation on two containers, or a container times a scalar,
+ *   goes to the SIMD kernels from simd.h. Longer chains run as one fused
+ *   loop over the flat index. Every element is only read at its own index,
+ *   so out may alias any container used in the expression.
+ */
+template <typename R, typename E>
+void evaluateLazy(const E &expression, R *out) {
+  if constexpr (std::is_same_v<R, typename E::value_type> &&
+                has_lazy_kernel<E>::value) {
+    lazyKernel(expression, out);
+  } else {
+    size_t n = expression.size();
+    for (size_t i = 0; i < n; i++) {
+      out[i] = static_cast<R>(expression.at(i));
+    }
+  }
+}
+
+/**
+ * @brief Returns Matrix operand as is, evaluates lazy one.
+ */
+template <typename T> const Matrix<T> &materializeLazy(const Matrix<T> &matrix) {
+  return matrix;
+}
+template <typename E>
+  requires is_lazy_expression<E>::value
+Matrix<typename E::value_type> materializeLazy(const E &expression) {
+  return Matrix<typename E::value_type>(expression);
+}
+
+/**
+ * @brief Adds two matrices or vectors elementwise (lazy).
+ * @tparam L Type of the first operand.
+ * @tparam R Type of the second operand.
+ * @param left First operand.
+ * @param right Second operand.
+ * @throws std::runtime_error if dimensions do not match.
+ * @return Expression of the elementwise sum.
+ */
+template <typename L, typename R>
+  requires lazy_operands<L, R>
+auto operator+(const L &left, const R &right) {
+  return LazyBinary<lazy_operand_t<L>, lazy_operand_t<R>, std::plus<>>(
+      toLazyOperand(left), toLazyOperand(right));
+}
+
+/**
+ * @brief Subtracts two matrices or vectors elementwise (lazy).
+ * @tparam L Type of the first operand.
+ * @tparam R Type of the second operand.
+ * @param left First operand.
+ * @param right Second operand.
+ * @throws std::runtime_error if dimensions do not match.
+ * @return Expression of the elementwise subtraction.
+ */
+template <typename L, typename R>
+  requires lazy_operands<L, R>
+auto operator-(const L &left, const R &right) {
+  return LazyBinary<lazy_operand_t<L>, lazy_operand_t<R>, std::minus<>>(
+      toLazyOperand(left), toLazyOperand(right));
+}
+
+/**
+ * @brief Divides two vectors elementwise (lazy).
+ */
+template <typename L, typename R>
+  requires(lazy_operands<L, R> &&
+           lazy_operand_t<L>::kind == ExpressionKind::Vector)
+auto operator/(const L &left, const R &right) {
+  return LazyBinary<lazy_operand_t<L>, lazy_operand_t<R>, std::divides<>>(
+      toLazyOperand(left), toLazyOperand(right));
+}
+
+/**
+ * @brief Multiplies matrix or vector by a scalar (lazy).
+ */
+template <typename E, typename S>
+  requires lazy_scalar_operands<E, S>
+auto operator*(const E &left, const S &scalar) {
+  return LazyScalar<lazy_operand_t<E>, S, std::multiplies<>>(
+      toLazyOperand(left), scalar);
+}
+
+/**
+ * @brief Multiplies scalar by a matrix or vector (lazy).
+ */
+template <typename S, typename E>
+  requires lazy_scalar_operands<E, S>
+auto operator*(const S &scalar, const E &right) {
+  return LazyScalar<lazy_operand_t<E>, S, std::multiplies<>>(
+      toLazyOperand(right), scalar);
+}
+
+/**
+ * @brief Divides matrix or vector by a scalar (lazy).
+ */
+template <typename E, typename S>
+  requires lazy_scalar_operands<E, S>
+auto operator/(const E &left, const S &scalar) {
+  return LazyScalar<lazy_operand_t<E>, S, std::divides<>>(toLazyOperand(left),
+                                                           scalar);
+}
+
+/**
+ * @brief Matrix product with lazy operand, evaluates it before gemm.
+ */
+template <typename L, typename R>
+  requires(lazy_operands<L, R> &&
+           (is_lazy_expression<L>::value || is_lazy_expression<R>::value) &&
+           lazy_operand_t<L>::kind == ExpressionKind::Matrix &&
+           lazy_operand_t<R>::kind == ExpressionKind::Matrix)
+auto operator*(const L &left, const R &right) {
+  return materializeLazy(left) * materializeLazy(right);
+}
+
+} // namespace notlab
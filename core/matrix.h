@@ -1,5 +1,6 @@
 #pragma once
 
+#include "gemm.h"
 #include "vector.h"
 #include <iostream>
 #include <sstream>
@@ -55,6 +56,43 @@ private:
         m_lastInstruction("none"), m_data(rows * cols) {}
 
 public:
+  /**
+   * @brief Evaluates lazy expression (e.g. A + B - C * 2) into a new Matrix.
+   * @details Name and last instruction are taken from the expression.
+   * @param expression Result of elementwise operators on matrices.
+   */
+  template <typename E>
+    requires(is_lazy_expression<E>::value &&
+             E::kind == ExpressionKind::Matrix)
+  Matrix(const E &expression)
+      : m_numOfRows(expression.rows()), m_numOfCols(expression.cols()),
+        m_data(expression.size()), m_name(expression.name()),
+        m_lastInstruction(expression.instruction()) {
+    evaluateLazy(expression, m_data.data());
+  }
+
+  /**
+   * @brief Evaluates lazy expression into this Matrix.
+   * @details Expression may use this Matrix, elements are computed in place.
+   * @param expression Result of elementwise operators on matrices.
+   * @return Matrix<T>& This Matrix.
+   */
+  template <typename E>
+    requires(is_lazy_expression<E>::value &&
+             E::kind == ExpressionKind::Matrix)
+  Matrix<T> &operator=(const E &expression) {
+    std::string name = expression.name();
+    if (m_data.size() != expression.size()) {
+      m_data.assign(expression.size(), T());
+    }
+    evaluateLazy(expression, m_data.data());
+    m_numOfRows = expression.rows();
+    m_numOfCols = expression.cols();
+    m_name = std::move(name);
+    m_lastInstruction = expression.instruction();
+    return *this;
+  }
+
   /**
    * @brief Creates a zero matrix of given size.
    * @param rows Number of rows.
@@ -241,12 +279,25 @@ public:
       throw std::runtime_error("Row out of bounds");
     }
 
-    Vector<T> rowVector = Vector<T>::zeros(0);
-    size_t firstElement = toIndex(row, 1);
-    rowVector.addBack(m_data, firstElement, firstElement + m_numOfCols);
-    return rowVector;
+    return rowView(row).toVector();
   }
 
+  /**
+   * @brief View of one row, writes go to this Matrix.
+   *
+   * @param row index of row
+   * @return VectorView<T> View of row
+   */
+  VectorView<T> rowView(size_t row) { return view().row(row); }
+
+  /**
+   * @brief Read-only view of one row.
+   *
+   * @param row index of row
+   * @return VectorView<const T> View of row
+   */
+  VectorView<const T> rowView(size_t row) const { return view().row(row); }
+
   /**
    * @brief Adds column to Matrix.
    *
@@ -328,12 +379,25 @@ public:
     if (column > m_numOfCols || column < 1) {
       throw std::runtime_error("column out of bounds");
     }
-    Vector<T> columnVector = Vector<T>::zeros(m_numOfRows);
+    return columnView(column).toVector();
+  }
 
-    for (size_t i = 1; i <= m_numOfRows; i++) {
-      columnVector(i) = m_data[toIndex(i, column)];
-    }
-    return columnVector;
+  /**
+   * @brief View of one column, writes go to this Matrix.
+   *
+   * @param column index of column
+   * @return VectorView<T> Strided view of column
+   */
+  VectorView<T> columnView(size_t column) { return view().column(column); }
+
+  /**
+   * @brief Read-only view of one column.
+   *
+   * @param column index of column
+   * @return VectorView<const T> Strided view of column
+   */
+  VectorView<const T> columnView(size_t column) const {
+    return view().column(column);
   }
 
   /**
@@ -344,28 +408,74 @@ public:
    * @return Matrix<T> Minor matrix.
    */
   Matrix<T> minorMatrix(size_t omitRow, size_t omitColumn) const {
-    if (getNumberOfElements() == 0) {
-      throw std::runtime_error("Can't calculate minor for empty matrix");
-    }
-    if (omitRow <= 0 || omitRow > m_numOfRows || omitColumn <= 0 ||
-        omitColumn > m_numOfCols) {
-      throw std::runtime_error(
-          "Index out of bound when calculation matrix minor");
-    }
-    Matrix<T> minor = Matrix<T>::empty();
-    for (size_t row = 1; row <= m_numOfRows; row++) {
-      Vector<T> rowVector = Vector<T>::zeros(0);
-      for (size_t column = 1; column <= m_numOfCols; column++) {
-        if (row == omitRow || column == omitColumn) {
-          continue;
-        }
-        rowVector.addBack(m_data[toIndex(row, column)]);
-      }
-      if (rowVector.getSize() != 0) {
-        minor.addRow(rowVector);
-      }
-    }
-    return minor;
+    return minorView(omitRow, omitColumn).toMatrix();
+  }
+
+  /**
+   * @brief View of Matrix without one row and one column.
+   *
+   * @param omitRow Row that is omited.
+   * @param omitColumn Column that is omited.
+   * @return MinorView<T> View of minor, writes go to this Matrix.
+   */
+  MinorView<T> minorView(size_t omitRow, size_t omitColumn) {
+    return view().minor(omitRow, omitColumn);
+  }
+
+  /**
+   * @brief Read-only view of Matrix without one row and one column.
+   *
+   * @param omitRow Row that is omited.
+   * @param omitColumn Column that is omited.
+   * @return MinorView<const T> View of minor.
+   */
+  MinorView<const T> minorView(size_t omitRow, size_t omitColumn) const {
+    return view().minor(omitRow, omitColumn);
+  }
+
+  /**
+   * @brief View of the whole Matrix, writes go to this Matrix.
+   *
+   * @return MatrixView<T> View of Matrix.
+   */
+  MatrixView<T> view() {
+    return MatrixView<T>(m_data.data(), m_numOfRows, m_numOfCols);
+  }
+
+  /**
+   * @brief Read-only view of the whole Matrix.
+   *
+   * @return MatrixView<const T> View of Matrix.
+   */
+  MatrixView<const T> view() const {
+    return MatrixView<const T>(m_data.data(), m_numOfRows, m_numOfCols);
+  }
+
+  /**
+   * @brief View of rectangular block, writes go to this Matrix.
+   *
+   * @param row First row of block.
+   * @param col First column of block.
+   * @param rows Number of rows of block.
+   * @param cols Number of columns of block.
+   * @return MatrixView<T> View of block.
+   */
+  MatrixView<T> blockView(size_t row, size_t col, size_t rows, size_t cols) {
+    return view().block(row, col, rows, cols);
+  }
+
+  /**
+   * @brief Read-only view of rectangular block.
+   *
+   * @param row First row of block.
+   * @param col First column of block.
+   * @param rows Number of rows of block.
+   * @param cols Number of columns of block.
+   * @return MatrixView<const T> View of block.
+   */
+  MatrixView<const T> blockView(size_t row, size_t col, size_t rows,
+                                size_t cols) const {
+    return view().block(row, col, rows, cols);
   }
 
   /**
@@ -415,6 +525,20 @@ public:
    */
   const std::vector<T> &getData() const { return m_data; }
 
+  /**
+   * @brief Get pointer to the first element of row-major storage.
+   *
+   * @return T* Unchecked pointer, row stride equals number of columns.
+   */
+  T *getRawData() { return m_data.data(); }
+
+  /**
+   * @brief Get read-only pointer to the first element of row-major storage.
+   *
+   * @return const T* Unchecked pointer, row stride equals number of columns.
+   */
+  const T *getRawData() const { return m_data.data(); }
+
   /**
    * @brief Returns a string representation of the matrix.
    * @return Matrix as a multi-line string.
@@ -508,6 +632,7 @@ public:
 
 using MatrixI = Matrix<int>;
 using MatrixF = Matrix<float>;
+using MatrixD = Matrix<double>;
 
 template <typename T, typename U, typename Op>
 auto elementwise(const Matrix<T> &left, const Matrix<U> &right, Op operation) {
@@ -519,32 +644,12 @@ auto elementwise(const Matrix<T> &left, const Matrix<U> &right, Op operation) {
   using resultType = decltype(operation(T(), U()));
   Matrix<resultType> resultMatrix = Matrix<resultType>::zeros(
       left.getNumberOfRows(), left.getNumberOfColums());
-  for (size_t row = 1; row <= left.getNumberOfRows(); row++) {
-    for (size_t column = 1; column <= left.getNumberOfColums(); column++) {
-      resultMatrix(row, column) =
-          operation(static_cast<resultType>(left(row, column)),
-                    static_cast<resultType>(right(row, column)));
-    }
-  }
+  elementwiseKernel(left.getRawData(), right.getRawData(),
+                    resultMatrix.getRawData(), left.getNumberOfElements(),
+                    operation);
   return resultMatrix;
 }
 
-template <typename T, typename U>
-auto operator+(const Matrix<T> &left, const Matrix<U> &right) {
-  auto matrix = elementwise(left, right, std::plus<>());
-  matrix.setName(left.getName() + "+" + right.getName());
-  matrix.setInstruction("Addition");
-  return matrix;
-}
-
-template <typename T, typename U>
-auto operator-(const Matrix<T> &left, const Matrix<U> &right) {
-  auto matrix = elementwise(left, right, std::minus<>());
-  matrix.setName(left.getName() + "-" + right.getName());
-  matrix.setInstruction("Subtraction");
-  return matrix;
-}
-
 template <typename T, typename U>
 auto operator*(const Matrix<T> &left, const Matrix<U> &right) {
   if (left.getNumberOfColums() != right.getNumberOfRows()) {
@@ -557,37 +662,13 @@ auto operator*(const Matrix<T> &left, const Matrix<U> &right) {
       left.getName() + "*" + right.getName());
   resultMatix.setInstruction("Multiplication");
 
-  for (size_t row = 1; row <= left.getNumberOfRows(); row++) {
-    for (size_t column = 1; column <= right.getNumberOfColums(); column++) {
-      resultType value = 0;
-      for (size_t k = 1; k <= left.getNumberOfColums(); k++) {
-        value += left(row, k) * right(k, column);
-      }
-      resultMatix(row, column) = value;
-    }
-  }
+  gemm(left.getNumberOfRows(), right.getNumberOfColums(),
+       left.getNumberOfColums(), left.getRawData(), left.getNumberOfColums(),
+       right.getRawData(), right.getNumberOfColums(),
+       resultMatix.getRawData(), resultMatix.getNumberOfColums());
   return resultMatix;
 }
 
-template <typename T, typename U>
-auto operator*(const Matrix<T> &left, const U &scalar) {
-  using resultType = decltype(T() * U());
-  Matrix<resultType> resultMatrix = Matrix<resultType>::zeros(
-      left.getNumberOfRows(), left.getNumberOfColums(), left.getName());
-  for (size_t row = 1; row <= left.getNumberOfRows(); row++) {
-    for (size_t column = 1; column <= left.getNumberOfColums(); column++) {
-      resultMatrix(row, column) = left(row, column) * scalar;
-    }
-  }
-  resultMatrix.setInstruction("Multiplication");
-  return resultMatrix;
-}
-
-template <typename T, typename U>
-auto operator*(const T &scalar, const Matrix<U> &left) {
-  return left * scalar;
-}
-
 template <typename T, typename U>
 auto operator/(const Matrix<T> &left, const Matrix<U> &right) {
   if (left.getNumberOfColums() != right.getNumberOfRows()) {
@@ -601,15 +682,10 @@ auto operator/(const Matrix<T> &left, const Matrix<U> &right) {
       left.getName() + "/" + right.getName());
   resultMatix.setInstruction("Division");
 
-  for (size_t row = 1; row <= left.getNumberOfRows(); row++) {
-    for (size_t column = 1; column <= right.getNumberOfColums(); column++) {
-      resultType value = 0;
-      for (size_t k = 1; k <= left.getNumberOfColums(); k++) {
-        value += left(row, k) * rightInverse(k, column);
-      }
-      resultMatix(row, column) = value;
-    }
-  }
+  gemm(left.getNumberOfRows(), right.getNumberOfColums(),
+       left.getNumberOfColums(), left.getRawData(), left.getNumberOfColums(),
+       rightInverse.getRawData(), rightInverse.getNumberOfColums(),
+       resultMatix.getRawData(), resultMatix.getNumberOfColums());
   return resultMatix;
 }
 
@@ -0,0 +1,471 @@
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <type_traits>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define NOTLAB_SIMD_X86 1
+#include <immintrin.h>
+#define NOTLAB_TARGET_AVX2 __attribute__((target("avx2")))
+#define NOTLAB_TARGET_AVX512 __attribute__((target("avx512f")))
+#elif defined(__ARM_NEON)
+#define NOTLAB_SIMD_NEON 1
+#include <arm_neon.h>
+#endif
+
+namespace notlab {
+
+/**
+ * @brief Instruction set used by the elementwise kernels.
+ * @details
+ *   Selected once at runtime from the CPU the program runs on. NEON is
+ *   chosen at compile time since every AArch64 CPU provides it.
+ *
+ *   Kernels only use lane-wise add, subtract and multiply without FMA or
+ *   reassociation, so every lane is rounded exactly like the scalar
+ *   expression: results are bit-identical (0 ULP) to the scalar loop for
+ *   int, float and double.
+ */
+enum class SimdLevel { Scalar = 0, Neon, Avx2, Avx512 };
+
+/// Elementwise operations that have vectorized kernels.
+enum class SimdOp { Add, Subtract, Multiply };
+
+/**
+ * @brief Detects the widest supported instruction set.
+ *
+ * @return SimdLevel Instruction set of the current CPU.
+ */
+inline SimdLevel detectSimdLevel() {
+#if defined(NOTLAB_SIMD_X86)
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx512f")) {
+    return SimdLevel::Avx512;
+  }
+  if (__builtin_cpu_supports("avx2")) {
+    return SimdLevel::Avx2;
+  }
+  return SimdLevel::Scalar;
+#elif defined(NOTLAB_SIMD_NEON)
+  return SimdLevel::Neon;
+#else
+  return SimdLevel::Scalar;
+#endif
+}
+
+/**
+ * @brief Returns cached instruction set used for dispatch.
+ *
+ * @return SimdLevel Instruction set detected on first call.
+ */
+inline SimdLevel simdLevel() {
+  static const SimdLevel level = detectSimdLevel();
+  return level;
+}
+
+/**
+ * @struct simd_op_of
+ * @brief Maps standard functor to SimdOp, if it has vectorized kernel.
+ * @tparam Op Functor type (e.g. std::plus<>).
+ */
+template <typename Op> struct simd_op_of {
+  static constexpr bool supported = false;
+};
+
+/// Specialization: std::plus<> maps to SimdOp::Add.
+template <> struct simd_op_of<std::plus<>> {
+  static constexpr bool supported = true;
+  static constexpr SimdOp value = SimdOp::Add;
+};
+/// Specialization: std::minus<> maps to SimdOp::Subtract.
+template <> struct simd_op_of<std::minus<>> {
+  static constexpr bool supported = true;
+  static constexpr SimdOp value = SimdOp::Subtract;
+};
+/// Specialization: std::multiplies<> maps to SimdOp::Multiply.
+template <> struct simd_op_of<std::multiplies<>> {
+  static constexpr bool supported = true;
+  static constexpr SimdOp value = SimdOp::Multiply;
+};
+
+template <SimdOp op, typename T> inline T simdScalarApply(T a, T b) {
+  if constexpr (op == SimdOp::Add) {
+    return a + b;
+  } else if constexpr (op == SimdOp::Subtract) {
+    return a - b;
+  } else {
+    return a * b;
+  }
+}
+
+#if defined(NOTLAB_SIMD_X86)
+
+// Lane wrappers give the AVX2/AVX-512 loops one interface for every type.
+struct Avx2Float {
+  using reg = __m256;
+  static constexpr size_t width = 8;
+  NOTLAB_TARGET_AVX2 static reg load(const float *p) {
+    return _mm256_loadu_ps(p);
+  }
+  NOTLAB_TARGET_AVX2 static void store(float *p, reg v) {
+    _mm256_storeu_ps(p, v);
+  }
+  NOTLAB_TARGET_AVX2 static reg broadcast(float v) {
+    return _mm256_set1_ps(v);
+  }
+  template <SimdOp op> NOTLAB_TARGET_AVX2 static reg apply(reg a, reg b) {
+    if constexpr (op == SimdOp::Add) {
+      return _mm256_add_ps(a, b);
+    } else if constexpr (op == SimdOp::Subtract) {
+      return _mm256_sub_ps(a, b);
+    } else {
+      return _mm256_mul_ps(a, b);
+    }
+  }
+};
+
+struct Avx2Double {
+  using reg = __m256d;
+  static constexpr size_t width = 4;
+  NOTLAB_TARGET_AVX2 static reg load(const double *p) {
+    return _mm256_loadu_pd(p);
+  }
+  NOTLAB_TARGET_AVX2 static void store(double *p, reg v) {
+    _mm256_storeu_pd(p, v);
+  }
+  NOTLAB_TARGET_AVX2 static reg broadcast(double v) {
+    return _mm256_set1_pd(v);
+  }
+  template <SimdOp op> NOTLAB_TARGET_AVX2 static reg apply(reg a, reg b) {
+    if constexpr (op == SimdOp::Add) {
+      return _mm256_add_pd(a, b);
+    } else if constexpr (op == SimdOp::Subtract) {
+      return _mm256_sub_pd(a, b);
+    } else {
+      return _mm256_mul_pd(a, b);
+    }
+  }
+};
+
+struct Avx2Int {
+  using reg = __m256i;
+  static constexpr size_t width = 8;
+  NOTLAB_TARGET_AVX2 static reg load(const int *p) {
+    return _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p));
+  }
+  NOTLAB_TARGET_AVX2 static void store(int *p, reg v) {
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(p), v);
+  }
+  NOTLAB_TARGET_AVX2 static reg broadcast(int v) {
+    return _mm256_set1_epi32(v);
+  }
+  template <SimdOp op> NOTLAB_TARGET_AVX2 static reg apply(reg a, reg b) {
+    if constexpr (op == SimdOp::Add) {
+      return _mm256_add_epi32(a, b);
+    } else if constexpr (op == SimdOp::Subtract) {
+      return _mm256_sub_epi32(a, b);
+    } else {
+      return _mm256_mullo_epi32(a, b);
+    }
+  }
+};
+
+struct Avx512Float {
+  using reg = __m512;
+  static constexpr size_t width = 16;
+  NOTLAB_TARGET_AVX512 static reg load(const float *p) {
+    return _mm512_loadu_ps(p);
+  }
+  NOTLAB_TARGET_AVX512 static void store(float *p, reg v) {
+    _mm512_storeu_ps(p, v);
+  }
+  NOTLAB_TARGET_AVX512 static reg broadcast(float v) {
+    return _mm512_set1_ps(v);
+  }
+  template <SimdOp op> NOTLAB_TARGET_AVX512 static reg apply(reg a, reg b) {
+    if constexpr (op == SimdOp::Add) {
+      return _mm512_add_ps(a, b);
+    } else if constexpr (op == SimdOp::Subtract) {
+      return _mm512_sub_ps(a, b);
+    } else {
+      return _mm512_mul_ps(a, b);
+    }
+  }
+};
+
+struct Avx512Double {
+  using reg = __m512d;
+  static constexpr size_t width = 8;
+  NOTLAB_TARGET_AVX512 static reg load(const double *p) {
+    return _mm512_loadu_pd(p);
+  }
+  NOTLAB_TARGET_AVX512 static void store(double *p, reg v) {
+    _mm512_storeu_pd(p, v);
+  }
+  NOTLAB_TARGET_AVX512 static reg broadcast(double v) {
+    return _mm512_set1_pd(v);
+  }
+  template <SimdOp op> NOTLAB_TARGET_AVX512 static reg apply(reg a, reg b) {
+    if constexpr (op == SimdOp::Add) {
+      return _mm512_add_pd(a, b);
+    } else if constexpr (op == SimdOp::Subtract) {
+      return _mm512_sub_pd(a, b);
+    } else {
+      return _mm512_mul_pd(a, b);
+    }
+  }
+};
+
+struct Avx512Int {
+  using reg = __m512i;
+  static constexpr size_t width = 16;
+  NOTLAB_TARGET_AVX512 static reg load(const int *p) {
+    return _mm512_loadu_si512(p);
+  }
+  NOTLAB_TARGET_AVX512 static void store(int *p, reg v) {
+    _mm512_storeu_si512(p, v);
+  }
+  NOTLAB_TARGET_AVX512 static reg broadcast(int v) {
+    return _mm512_set1_epi32(v);
+  }
+  template <SimdOp op> NOTLAB_TARGET_AVX512 static reg apply(reg a, reg b) {
+    if constexpr (op == SimdOp::Add) {
+      return _mm512_add_epi32(a, b);
+    } else if constexpr (op == SimdOp::Subtract) {
+      return _mm512_sub_epi32(a, b);
+    } else {
+      return _mm512_mullo_epi32(a, b);
+    }
+  }
+};
+
+template <typename T> struct avx2_lanes {};
+template <> struct avx2_lanes<int> { using type = Avx2Int; };
+template <> struct avx2_lanes<float> { using type = Avx2Float; };
+template <> struct avx2_lanes<double> { using type = Avx2Double; };
+
+template <typename T> struct avx512_lanes {};
+template <> struct avx512_lanes<int> { using type = Avx512Int; };
+template <> struct avx512_lanes<float> { using type = Avx512Float; };
+template <> struct avx512_lanes<double> { using type = Avx512Double; };
+
+template <SimdOp op, typename T>
+NOTLAB_TARGET_AVX2 void simdBinaryAvx2(const T *left, const T *right, T *out,
+                                       size_t n) {
+  using Lanes = typename avx2_lanes<T>::type;
+  size_t i = 0;
+  for (; i + Lanes::width <= n; i += Lanes::width) {
+    Lanes::store(out + i, Lanes::template apply<op>(Lanes::load(left + i),
+                                                    Lanes::load(right + i)));
+  }
+  for (; i < n; i++) {
+    out[i] = simdScalarApply<op>(left[i], right[i]);
+  }
+}
+
+template <typename T>
+NOTLAB_TARGET_AVX2 void simdScaleAvx2(const T *in, T scalar, T *out,
+                                      size_t n) {
+  using Lanes = typename avx2_lanes<T>::type;
+  typename Lanes::reg factor = Lanes::broadcast(scalar);
+  size_t i = 0;
+  for (; i + Lanes::width <= n; i += Lanes::width) {
+    Lanes::store(out + i, Lanes::template apply<SimdOp::Multiply>(
+                              Lanes::load(in + i), factor));
+  }
+  for (; i < n; i++) {
+    out[i] = in[i] * scalar;
+  }
+}
+
+template <SimdOp op, typename T>
+NOTLAB_TARGET_AVX512 void simdBinaryAvx512(const T *left, const T *right,
+                                           T *out, size_t n) {
+  using Lanes = typename avx512_lanes<T>::type;
+  size_t i = 0;
+  for (; i + Lanes::width <= n; i += Lanes::width) {
+    Lanes::store(out + i, Lanes::template apply<op>(Lanes::load(left + i),
+                                                    Lanes::load(right + i)));
+  }
+  for (; i < n; i++) {
+    out[i] = simdScalarApply<op>(left[i], right[i]);
+  }
+}
+
+template <typename T>
+NOTLAB_TARGET_AVX512 void simdScaleAvx512(const T *in, T scalar, T *out,
+                                          size_t n) {
+  using Lanes = typename avx512_lanes<T>::type;
+  typename Lanes::reg factor = Lanes::broadcast(scalar);
+  size_t i = 0;
+  for (; i + Lanes::width <= n; i += Lanes::width) {
+    Lanes::store(out + i, Lanes::template apply<SimdOp::Multiply>(
+                              Lanes::load(in + i), factor));
+  }
+  for (; i < n; i++) {
+    out[i] = in[i] * scalar;
+  }
+}
+
+#endif // NOTLAB_SIMD_X86
+
+#if defined(NOTLAB_SIMD_NEON)
+
+template <SimdOp op, typename T>
+void simdBinaryNeon(const T *left, const T *right, T *out, size_t n) {
+  size_t i = 0;
+  if constexpr (std::is_same_v<T, float>) {
+    for (; i + 4 <= n; i += 4) {
+      float32x4_t a = vld1q_f32(left + i);
+      float32x4_t b = vld1q_f32(right + i);
+      if constexpr (op == SimdOp::Add) {
+        vst1q_f32(out + i, vaddq_f32(a, b));
+      } else if constexpr (op == SimdOp::Subtract) {
+        vst1q_f32(out + i, vsubq_f32(a, b));
+      } else {
+        vst1q_f32(out + i, vmulq_f32(a, b));
+      }
+    }
+  } else if constexpr (std::is_same_v<T, int>) {
+    for (; i + 4 <= n; i += 4) {
+      int32x4_t a = vld1q_s32(left + i);
+      int32x4_t b = vld1q_s32(right + i);
+      if constexpr (op == SimdOp::Add) {
+        vst1q_s32(out + i, vaddq_s32(a, b));
+      } else if constexpr (op == SimdOp::Subtract) {
+        vst1q_s32(out + i, vsubq_s32(a, b));
+      } else {
+        vst1q_s32(out + i, vmulq_s32(a, b));
+      }
+    }
+  }
+#if defined(__aarch64__)
+  else if constexpr (std::is_same_v<T, double>) {
+    for (; i + 2 <= n; i += 2) {
+      float64x2_t a = vld1q_f64(left + i);
+      float64x2_t b = vld1q_f64(right + i);
+      if constexpr (op == SimdOp::Add) {
+        vst1q_f64(out + i, vaddq_f64(a, b));
+      } else if constexpr (op == SimdOp::Subtract) {
+        vst1q_f64(out + i, vsubq_f64(a, b));
+      } else {
+        vst1q_f64(out + i, vmulq_f64(a, b));
+      }
+    }
+  }
+#endif
+  for (; i < n; i++) {
+    out[i] = simdScalarApply<op>(left[i], right[i]);
+  }
+}
+
+template <typename T>
+void simdScaleNeon(const T *in, T scalar, T *out, size_t n) {
+  size_t i = 0;
+  if constexpr (std::is_same_v<T, float>) {
+    for (; i + 4 <= n; i += 4) {
+      vst1q_f32(out + i, vmulq_n_f32(vld1q_f32(in + i), scalar));
+    }
+  } else if constexpr (std::is_same_v<T, int>) {
+    for (; i + 4 <= n; i += 4) {
+      vst1q_s32(out + i, vmulq_n_s32(vld1q_s32(in + i), scalar));
+    }
+  }
+#if defined(__aarch64__)
+  else if constexpr (std::is_same_v<T, double>) {
+    for (; i + 2 <= n; i += 2) {
+      vst1q_f64(out + i, vmulq_n_f64(vld1q_f64(in + i), scalar));
+    }
+  }
+#endif
+  for (; i < n; i++) {
+    out[i] = in[i] * scalar;
+  }
+}
+
+#endif // NOTLAB_SIMD_NEON
+
+/**
+ * @brief Vectorized out[i] = left[i] op right[i].
+ * @details Dispatches on simdLevel(), falls back to scalar loop.
+ * @tparam op Operation.
+ * @tparam T Element type (int, float or double).
+ */
+template <SimdOp op, typename T>
+void simdBinary(const T *left, const T *right, T *out, size_t n) {
+#if defined(NOTLAB_SIMD_X86)
+  switch (simdLevel()) {
+  case SimdLevel::Avx512:
+    return simdBinaryAvx512<op>(left, right, out, n);
+  case SimdLevel::Avx2:
+    return simdBinaryAvx2<op>(left, right, out, n);
+  default:
+    break;
+  }
+#elif defined(NOTLAB_SIMD_NEON)
+  return simdBinaryNeon<op>(left, right, out, n);
+#endif
+  for (size_t i = 0; i < n; i++) {
+    out[i] = simdScalarApply<op>(left[i], right[i]);
+  }
+}
+
+/**
+ * @brief Vectorized out[i] = in[i] * scalar.
+ * @tparam T Element type (int, float or double).
+ */
+template <typename T> void simdScale(const T *in, T scalar, T *out, size_t n) {
+#if defined(NOTLAB_SIMD_X86)
+  switch (simdLevel()) {
+  case SimdLevel::Avx512:
+    return simdScaleAvx512(in, scalar, out, n);
+  case SimdLevel::Avx2:
+    return simdScaleAvx2(in, scalar, out, n);
+  default:
+    break;
+  }
+#elif defined(NOTLAB_SIMD_NEON)
+  return simdScaleNeon(in, scalar, out, n);
+#endif
+  for (size_t i = 0; i < n; i++) {
+    out[i] = in[i] * scalar;
+  }
+}
+
+/**
+ * @brief Elementwise kernel used by Matrix and Vector operators.
+ * @details
+ *   Uses vectorized kernel when both operands already have the result type
+ *   and operation is std::plus<>, std::minus<> or std::multiplies<>.
+ *   Otherwise runs a plain loop on raw storage.
+ */
+template <typename R, typename T, typename U, typename Op>
+void elementwiseKernel(const T *left, const U *right, R *out, size_t n,
+                       Op operation) {
+  if constexpr (std::is_same_v<T, R> && std::is_same_v<U, R> &&
+                simd_op_of<Op>::supported) {
+    simdBinary<simd_op_of<Op>::value>(left, right, out, n);
+  } else {
+    for (size_t i = 0; i < n; i++) {
+      out[i] = operation(static_cast<R>(left[i]), static_cast<R>(right[i]));
+    }
+  }
+}
+
+/**
+ * @brief Scalar multiplication kernel used by Matrix and Vector operators.
+ * @details Vectorized when operand and scalar already have the result type.
+ */
+template <typename R, typename T, typename U>
+void scaleKernel(const T *in, const U &scalar, R *out, size_t n) {
+  if constexpr (std::is_same_v<T, R> && std::is_same_v<U, R>) {
+    simdScale(in, scalar, out, n);
+  } else {
+    for (size_t i = 0; i < n; i++) {
+      out[i] = in[i] * scalar;
+    }
+  }
+}
+
+} // namespace notlab
@@ -0,0 +1,339 @@
+#pragma once
+
+#include "simd.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+
+namespace notlab {
+
+/**
+ * @brief Largest |x| reduced by the vectorized sine.
+ * @details
+ *   Cody-Waite reduction with a three part pi/2 stays accurate up to here.
+ *   Vectors holding a larger, infinite or NaN argument fall back to std::sin.
+ */
+constexpr float simdSinMaxArgument = 8192.0f;
+
+namespace detail {
+// pi/2 in three parts for Cody-Waite reduction.
+constexpr float sinTwoOverPi = 0.636619772367581343f;
+constexpr float sinPi2Part1 = 1.5703125f;
+constexpr float sinPi2Part2 = 4.837512969970703125e-4f;
+constexpr float sinPi2Part3 = 7.54978995489188216e-8f;
+// Minimax polynomials on [-pi/4, pi/4].
+constexpr float sinCoefficients[3] = {-1.9515295891e-4f, 8.3321608736e-3f,
+                                      -1.6666654611e-1f};
+constexpr float cosCoefficients[3] = {2.443315711809948e-5f,
+                                      -1.388731625493765e-3f,
+                                      4.166664568298827e-2f};
+} // namespace detail
+
+/**
+ * @brief Sine of one value, bit-identical to a lane of simdSin.
+ * @details
+ *   Same reduction and polynomials as the AVX2 kernel, one rounding per
+ *   operation and in the same order, so scalar and vector evaluation
+ *   agree. Only holds if the compiler doesn't contract this code into fma,
+ *   build with -ffp-contract=off.
+ */
+inline float sinKernel(float x) {
+  if (!(std::fabs(x) < simdSinMaxArgument)) {
+    return std::sin(x);
+  }
+  float quadrant = std::nearbyint(x * detail::sinTwoOverPi);
+  int q = static_cast<int>(quadrant);
+  float r = x - quadrant * detail::sinPi2Part1;
+  r = r - quadrant * detail::sinPi2Part2;
+  r = r - quadrant * detail::sinPi2Part3;
+  float r2 = r * r;
+
+  float sinPoly = detail::sinCoefficients[0];
+  sinPoly = sinPoly * r2;
+  sinPoly = sinPoly + detail::sinCoefficients[1];
+  sinPoly = sinPoly * r2;
+  sinPoly = sinPoly + detail::sinCoefficients[2];
+  sinPoly = sinPoly * r2;
+  sinPoly = sinPoly * r;
+  sinPoly = r + sinPoly;
+
+  float cosPoly = detail::cosCoefficients[0];
+  cosPoly = cosPoly * r2;
+  cosPoly = cosPoly + detail::cosCoefficients[1];
+  cosPoly = cosPoly * r2;
+  cosPoly = cosPoly + detail::cosCoefficients[2];
+  cosPoly = cosPoly * r2;
+  cosPoly = cosPoly * r2;
+  float halfR2 = r2 * 0.5f;
+  cosPoly = cosPoly - halfR2;
+  cosPoly = cosPoly + 1.0f;
+
+  float result = (q & 1) ? cosPoly : sinPoly;
+  return (q & 2) ? -result : result;
+}
+
+/**
+ * @brief std::sin, so code generic over precision can call sinKernel.
+ */
+inline double sinKernel(double x) { return std::sin(x); }
+
+#if defined(NOTLAB_SIMD_X86)
+
+NOTLAB_TARGET_AVX2 inline void simdDivideAvx2(const float *left,
+                                              const float *right, float *out,
+                                              size_t n) {
+  size_t i = 0;
+  for (; i + 8 <= n; i += 8) {
+    _mm256_storeu_ps(out + i, _mm256_div_ps(_mm256_loadu_ps(left + i),
+                                            _mm256_loadu_ps(right + i)));
+  }
+  for (; i < n; i++) {
+    out[i] = left[i] / right[i];
+  }
+}
+
+NOTLAB_TARGET_AVX2 inline void simdMaxAvx2(const float *left,
+                                           const float *right, float *out,
+                                           size_t n) {
+  size_t i = 0;
+  for (; i + 8 <= n; i += 8) {
+    // max_ps returns its second operand when unordered, like std::max(a, b).
+    _mm256_storeu_ps(out + i, _mm256_max_ps(_mm256_loadu_ps(right + i),
+                                            _mm256_loadu_ps(left + i)));
+  }
+  for (; i < n; i++) {
+    out[i] = std::max(left[i], right[i]);
+  }
+}
+
+NOTLAB_TARGET_AVX2 inline void simdSqrtAvx2(const float *in, float *out,
+                                            size_t n) {
+  size_t i = 0;
+  for (; i + 8 <= n; i += 8) {
+    _mm256_storeu_ps(out + i, _mm256_sqrt_ps(_mm256_loadu_ps(in + i)));
+  }
+  for (; i < n; i++) {
+    out[i] = std::sqrt(in[i]);
+  }
+}
+
+NOTLAB_TARGET_AVX2 inline void simdSinAvx2(const float *in, float *out,
+                                           size_t n) {
+  const __m256 twoOverPi = _mm256_set1_ps(detail::sinTwoOverPi);
+  const __m256 pi2Part1 = _mm256_set1_ps(detail::sinPi2Part1);
+  const __m256 pi2Part2 = _mm256_set1_ps(detail::sinPi2Part2);
+  const __m256 pi2Part3 = _mm256_set1_ps(detail::sinPi2Part3);
+  const __m256 limit = _mm256_set1_ps(simdSinMaxArgument);
+  const __m256 signMask = _mm256_set1_ps(-0.0f);
+
+  size_t i = 0;
+  for (; i + 8 <= n; i += 8) {
+    __m256 x = _mm256_loadu_ps(in + i);
+    __m256 absX = _mm256_andnot_ps(signMask, x);
+    // Also true for NaN. sinKernel treats lanes in range like this loop does.
+    if (_mm256_movemask_ps(_mm256_cmp_ps(absX, limit, _CMP_NLT_UQ)) != 0) {
+      for (size_t j = i; j < i + 8; j++) {
+        out[j] = sinKernel(in[j]);
+      }
+      continue;
+    }
+
+    __m256 quadrant = _mm256_round_ps(
+        _mm256_mul_ps(x, twoOverPi), _MM_FROUND_TO_NEAREST_INT |
+                                         _MM_FROUND_NO_EXC);
+    __m256i q = _mm256_cvtps_epi32(quadrant);
+    __m256 r = _mm256_sub_ps(x, _mm256_mul_ps(quadrant, pi2Part1));
+    r = _mm256_sub_ps(r, _mm256_mul_ps(quadrant, pi2Part2));
+    r = _mm256_sub_ps(r, _mm256_mul_ps(quadrant, pi2Part3));
+    __m256 r2 = _mm256_mul_ps(r, r);
+
+    __m256 sinPoly = _mm256_set1_ps(detail::sinCoefficients[0]);
+    sinPoly = _mm256_add_ps(_mm256_mul_ps(sinPoly, r2),
+                            _mm256_set1_ps(detail::sinCoefficients[1]));
+    sinPoly = _mm256_add_ps(_mm256_mul_ps(sinPoly, r2),
+                            _mm256_set1_ps(detail::sinCoefficients[2]));
+    sinPoly = _mm256_add_ps(
+        r, _mm256_mul_ps(_mm256_mul_ps(sinPoly, r2), r));
+
+    __m256 cosPoly = _mm256_set1_ps(detail::cosCoefficients[0]);
+    cosPoly = _mm256_add_ps(_mm256_mul_ps(cosPoly, r2),
+                            _mm256_set1_ps(detail::cosCoefficients[1]));
+    cosPoly = _mm256_add_ps(_mm256_mul_ps(cosPoly, r2),
+                            _mm256_set1_ps(detail::cosCoefficients[2]));
+    cosPoly = _mm256_mul_ps(_mm256_mul_ps(cosPoly, r2), r2);
+    cosPoly = _mm256_sub_ps(cosPoly, _mm256_mul_ps(r2, _mm256_set1_ps(0.5f)));
+    cosPoly = _mm256_add_ps(cosPoly, _mm256_set1_ps(1.0f));
+
+    // Odd quadrants take cosine, quadrants 2 and 3 flip the sign.
+    __m256 useCos = _mm256_castsi256_ps(_mm256_cmpeq_epi32(
+        _mm256_and_si256(q, _mm256_set1_epi32(1)), _mm256_set1_epi32(1)));
+    __m256 result = _mm256_blendv_ps(sinPoly, cosPoly, useCos);
+    __m256 flip = _mm256_castsi256_ps(
+        _mm256_slli_epi32(_mm256_and_si256(q, _mm256_set1_epi32(2)), 30));
+    _mm256_storeu_ps(out + i, _mm256_xor_ps(result, flip));
+  }
+  for (; i < n; i++) {
+    out[i] = sinKernel(in[i]);
+  }
+}
+
+NOTLAB_TARGET_AVX2 inline void simdDivideAvx2(const double *left,
+                                              const double *right, double *out,
+                                              size_t n) {
+  size_t i = 0;
+  for (; i + 4 <= n; i += 4) {
+    _mm256_storeu_pd(out + i, _mm256_div_pd(_mm256_loadu_pd(left + i),
+                                            _mm256_loadu_pd(right + i)));
+  }
+  for (; i < n; i++) {
+    out[i] = left[i] / right[i];
+  }
+}
+
+NOTLAB_TARGET_AVX2 inline void simdMaxAvx2(const double *left,
+                                           const double *right, double *out,
+                                           size_t n) {
+  size_t i = 0;
+  for (; i + 4 <= n; i += 4) {
+    _mm256_storeu_pd(out + i, _mm256_max_pd(_mm256_loadu_pd(right + i),
+                                            _mm256_loadu_pd(left + i)));
+  }
+  for (; i < n; i++) {
+    out[i] = std::max(left[i], right[i]);
+  }
+}
+
+NOTLAB_TARGET_AVX2 inline void simdSqrtAvx2(const double *in, double *out,
+                                            size_t n) {
+  size_t i = 0;
+  for (; i + 4 <= n; i += 4) {
+    _mm256_storeu_pd(out + i, _mm256_sqrt_pd(_mm256_loadu_pd(in + i)));
+  }
+  for (; i < n; i++) {
+    out[i] = std::sqrt(in[i]);
+  }
+}
+
+#endif // NOTLAB_SIMD_X86
+
+/**
+ * @brief Vectorized out[i] = left[i] / right[i] for float.
+ * @details IEEE division, bit-identical to the scalar loop.
+ */
+inline void simdDivide(const float *left, const float *right, float *out,
+                       size_t n) {
+#if defined(NOTLAB_SIMD_X86)
+  if (simdLevel() >= SimdLevel::Avx2) {
+    return simdDivideAvx2(left, right, out, n);
+  }
+#endif
+  for (size_t i = 0; i < n; i++) {
+    out[i] = left[i] / right[i];
+  }
+}
+
+/**
+ * @brief Vectorized out[i] = left[i] / right[i] for double.
+ */
+inline void simdDivide(const double *left, const double *right, double *out,
+                       size_t n) {
+#if defined(NOTLAB_SIMD_X86)
+  if (simdLevel() >= SimdLevel::Avx2) {
+    return simdDivideAvx2(left, right, out, n);
+  }
+#endif
+  for (size_t i = 0; i < n; i++) {
+    out[i] = left[i] / right[i];
+  }
+}
+
+/**
+ * @brief Vectorized out[i] = std::max(left[i], right[i]) for float.
+ */
+inline void simdMax(const float *left, const float *right, float *out,
+                    size_t n) {
+#if defined(NOTLAB_SIMD_X86)
+  if (simdLevel() >= SimdLevel::Avx2) {
+    return simdMaxAvx2(left, right, out, n);
+  }
+#endif
+  for (size_t i = 0; i < n; i++) {
+    out[i] = std::max(left[i], right[i]);
+  }
+}
+
+/**
+ * @brief Vectorized out[i] = std::max(left[i], right[i]) for double.
+ */
+inline void simdMax(const double *left, const double *right, double *out,
+                    size_t n) {
+#if defined(NOTLAB_SIMD_X86)
+  if (simdLevel() >= SimdLevel::Avx2) {
+    return simdMaxAvx2(left, right, out, n);
+  }
+#endif
+  for (size_t i = 0; i < n; i++) {
+    out[i] = std::max(left[i], right[i]);
+  }
+}
+
+/**
+ * @brief Vectorized out[i] = sqrt(in[i]) for float.
+ * @details IEEE square root, bit-identical to std::sqrt. in may equal out.
+ */
+inline void simdSqrt(const float *in, float *out, size_t n) {
+#if defined(NOTLAB_SIMD_X86)
+  if (simdLevel() >= SimdLevel::Avx2) {
+    return simdSqrtAvx2(in, out, n);
+  }
+#endif
+  for (size_t i = 0; i < n; i++) {
+    out[i] = std::sqrt(in[i]);
+  }
+}
+
+/**
+ * @brief Vectorized out[i] = sqrt(in[i]) for double. in may equal out.
+ */
+inline void simdSqrt(const double *in, double *out, size_t n) {
+#if defined(NOTLAB_SIMD_X86)
+  if (simdLevel() >= SimdLevel::Avx2) {
+    return simdSqrtAvx2(in, out, n);
+  }
+#endif
+  for (size_t i = 0; i < n; i++) {
+    out[i] = std::sqrt(in[i]);
+  }
+}
+
+/**
+ * @brief Vectorized out[i] = sinKernel(in[i]) for float.
+ * @details
+ *   Cephes style minimax polynomials after Cody-Waite reduction. Absolute
+ *   error against std::sin stays below 1e-7 for |x| < simdSinMaxArgument,
+ *   larger arguments use std::sin. Other CPUs call sinKernel per value,
+ *   so results don't depend on the path taken. in may equal out.
+ */
+inline void simdSin(const float *in, float *out, size_t n) {
+#if defined(NOTLAB_SIMD_X86)
+  if (simdLevel() >= SimdLevel::Avx2) {
+    return simdSinAvx2(in, out, n);
+  }
+#endif
+  for (size_t i = 0; i < n; i++) {
+    out[i] = sinKernel(in[i]);
+  }
+}
+
+/**
+ * @brief out[i] = std::sin(in[i]) for double, no polynomial kernel keeps
+ * double precision yet. in may equal out.
+ */
+inline void simdSin(const double *in, double *out, size_t n) {
+  for (size_t i = 0; i < n; i++) {
+    out[i] = std::sin(in[i]);
+  }
+}
+
+} // namespace notlab
@@ -0,0 +1,159 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace notlab {
+
+/**
+ * @class ThreadPool
+ * @brief Fixed set of worker threads running chunked parallel loops.
+ * @details
+ *   parallelFor splits [0, count) into chunks of equal size that workers
+ *   (and the calling thread) take from a shared counter. Every chunk writes
+ *   only its own range, so results don't depend on which thread ran it.
+ *   One loop runs at a time; concurrent callers wait for their turn. Loop
+ *   bodies must not call parallelFor on the same pool.
+ */
+class ThreadPool {
+private:
+  std::vector<std::thread> m_workers;
+  std::mutex m_mutex;
+  std::mutex m_submitMutex;
+  std::condition_variable m_wake;
+  std::condition_variable m_done;
+
+  const std::function<void(size_t)> *m_chunk = nullptr;
+  size_t m_numberOfChunks = 0;
+  std::atomic<size_t> m_nextChunk{0};
+  size_t m_activeWorkers = 0;
+  size_t m_generation = 0;
+  bool m_stop = false;
+  std::exception_ptr m_error;
+
+  void runChunks() {
+    for (;;) {
+      size_t chunk = m_nextChunk.fetch_add(1);
+      if (chunk >= m_numberOfChunks) {
+        return;
+      }
+      try {
+        (*m_chunk)(chunk);
+      } catch (...) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (!m_error) {
+          m_error = std::current_exception();
+        }
+      }
+    }
+  }
+
+  void workerLoop() {
+    size_t seenGeneration = 0;
+    std::unique_lock<std::mutex> lock(m_mutex);
+    for (;;) {
+      m_wake.wait(lock,
+                  [&] { return m_stop || m_generation != seenGeneration; });
+      if (m_stop) {
+        return;
+      }
+      seenGeneration = m_generation;
+      lock.unlock();
+      runChunks();
+      lock.lock();
+      if (--m_activeWorkers == 0) {
+        m_done.notify_one();
+      }
+    }
+  }
+
+public:
+  /**
+   * @brief Creates pool.
+   * @param numberOfThreads Threads taking part in a loop, including the
+   * caller. 0 means one per hardware thread.
+   */
+  explicit ThreadPool(size_t numberOfThreads = 0) {
+    if (numberOfThreads == 0) {
+      numberOfThreads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    for (size_t i = 1; i < numberOfThreads; i++) {
+      m_workers.emplace_back([this] { workerLoop(); });
+    }
+  }
+
+  ThreadPool(const ThreadPool &) = delete;
+  ThreadPool &operator=(const ThreadPool &) = delete;
+
+  ~ThreadPool() {
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      m_stop = true;
+    }
+    m_wake.notify_all();
+    for (std::thread &worker : m_workers) {
+      worker.join();
+    }
+  }
+
+  /**
+   * @brief Number of threads taking part in a loop, including the caller.
+   */
+  size_t getNumberOfThreads() const { return m_workers.size() + 1; }
+
+  /**
+   * @brief Runs body(from, to) over [0, count) split into chunks.
+   * @details Blocks until every chunk is done. The first exception thrown
+   * by a chunk is rethrown here after all chunks finished.
+   * @param count Size of the range.
+   * @param chunkSize Number of indices per chunk.
+   * @param body Callable taking half-open range (size_t from, size_t to).
+   */
+  template <typename F>
+  void parallelFor(size_t count, size_t chunkSize, F &&body) {
+    if (count == 0) {
+      return;
+    }
+    chunkSize = std::max<size_t>(chunkSize, 1);
+    size_t numberOfChunks = (count + chunkSize - 1) / chunkSize;
+    if (m_workers.empty() || numberOfChunks == 1) {
+      body(size_t(0), count);
+      return;
+    }
+
+    std::function<void(size_t)> chunk = [&](size_t index) {
+      size_t from = index * chunkSize;
+      body(from, std::min(count, from + chunkSize));
+    };
+
+    std::lock_guard<std::mutex> submit(m_submitMutex);
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      m_chunk = &chunk;
+      m_numberOfChunks = numberOfChunks;
+      m_nextChunk = 0;
+      m_activeWorkers = m_workers.size();
+      m_error = nullptr;
+      m_generation++;
+    }
+    m_wake.notify_all();
+
+    runChunks();
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_done.wait(lock, [&] { return m_activeWorkers == 0; });
+    m_chunk = nullptr;
+    if (m_error) {
+      std::rethrow_exception(m_error);
+    }
+  }
+};
+
+} // namespace notlab
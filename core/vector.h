@@ -4,6 +4,8 @@
 #include <string>
 #include <sstream>
 #include <iostream>
+#include "lazy_expression.h"
+#include "view.h"
 
 namespace notlab
 {
@@ -52,6 +54,31 @@ namespace notlab
              * @param cap Vector size.
              */
             explicit Vector(size_t cap): m_data(cap) {}
+
+            /**
+             * @brief Evaluates lazy expression (e.g. a + b * 2) into a new Vector.
+             * @param expression Result of elementwise operators on vectors.
+             */
+            template<typename E>
+            requires(is_lazy_expression<E>::value && E::kind == ExpressionKind::Vector)
+            Vector(const E& expression): m_data(expression.size()){
+                evaluateLazy(expression, m_data.data());
+            }
+
+            /**
+             * @brief Evaluates lazy expression into this Vector.
+             * @details Expression may use this Vector, elements are computed in place.
+             * @param expression Result of elementwise operators on vectors.
+             */
+            template<typename E>
+            requires(is_lazy_expression<E>::value && E::kind == ExpressionKind::Vector)
+            Vector<T>& operator=(const E& expression){
+                if(m_data.size() != expression.size()){
+                    m_data.assign(expression.size(), T());
+                }
+                evaluateLazy(expression, m_data.data());
+                return *this;
+            }
             /**
              * @brief Create a new vector of zeros.
              * @param n Size of the new vector.
@@ -194,6 +221,42 @@ namespace notlab
                 return m_data;
             }
 
+            /**
+             * @brief Get pointer to the first element.
+             * 
+             * @return T* Unchecked pointer to contiguous storage.
+             */
+            T* getRawData(){
+                return m_data.data();
+            }
+
+            /**
+             * @brief Get read-only pointer to the first element.
+             * 
+             * @return const T* Unchecked pointer to contiguous storage.
+             */
+            const T* getRawData() const{
+                return m_data.data();
+            }
+
+            /**
+             * @brief View of all elements, writes go to this Vector.
+             * 
+             * @return VectorView<T> View of elements.
+             */
+            VectorView<T> view(){
+                return VectorView<T>(m_data.data(), m_data.size());
+            }
+
+            /**
+             * @brief Read-only view of all elements.
+             * 
+             * @return VectorView<const T> View of elements.
+             */
+            VectorView<const T> view() const{
+                return VectorView<const T>(m_data.data(), m_data.size());
+            }
+
             /**
              * @brief Get the number of elements in the vector.
              * @return Vector size.
@@ -277,77 +340,7 @@ namespace notlab
         }
         using resultType = decltype(operation(T() , U()));
         Vector<resultType> result(left.getSize());
-        for(size_t i = 0; i<left.getSize(); i++){
-            result[i] = operation(static_cast<resultType>(left[i]), static_cast<resultType>(right[i]));
-        }
-        return result;
-    }
-
-    /**
-     * @brief Adds two vectors elementwise.
-     * @tparam T Type of the first vector.
-     * @tparam U Type of the second vector.
-     * @param left First vector.
-     * @param right Second vector.
-     * @return Vector of the elementwise sum.
-     */
-    template<typename T, typename U>
-    auto operator+(const Vector<T>& left, const Vector<U>& right) {return elementwise(left, right, std::plus<>());}
-    /// Analogously for operator- (subtraction), operator* (multiplication), and operator/ (division).
-
-    /**
-     * @brief Subtrats two vectors elementwise.
-     * @tparam T Type of the first vector.
-     * @tparam U Type of the second vector.
-     * @param left First vector.
-     * @param right Second vector.
-     * @return Vector of the elementwise subtraction.
-     */
-    template<typename T, typename U>
-    auto operator-(const Vector<T>& left, const Vector<U>& right) {return elementwise(left, right, std::minus<>());}
-
-    /**
-     * @brief Multiplies a vector by a scalar (vector * scalar).
-     */
-    template<typename T, typename U>
-    auto operator*(const Vector<T>& left, const U& scalar) {
-        using resultType = decltype(T() + U());
-        Vector<resultType> result(left.getSize());
-        for(size_t i = 0; i<left.getSize(); i++){
-            result[i] = left[i] * scalar;
-        }
-        return result;
-    }
-
-    /**
-     * @brief Multiplies a scalar by a vector (scalar * vector).
-     */
-    template<typename T, typename U>
-    auto operator*(const T& scalar, const Vector<U>& right) {
-        using resultType = decltype(T() + U());
-        Vector<resultType> result(right.getSize());
-        for(size_t i = 0; i<right.getSize(); i++){
-            result[i] = right[i] * scalar;
-        }
-        return result;
-    }
-
-    /**
-     * @brief Divides two vectors elementwise.
-     */
-    template<typename T, typename U>
-    auto operator/(const Vector<T>& left, const Vector<U>& right) {return elementwise(left, right, std::divides<>());}
-
-    /**
-     * @brief Divides a vector by a scalar.
-     */
-    template<typename T, typename U>
-    auto operator/(const Vector<T>& left, const U& scalar) {
-        using resultType = decltype(T() + U());
-        Vector<resultType> result(left.getSize());
-        for(size_t i = 0; i<left.getSize(); i++){
-            result[i] = left[i] / scalar;
-        }
+        elementwiseKernel(left.getRawData(), right.getRawData(), result.getRawData(), left.getSize(), operation);
         return result;
     }
 
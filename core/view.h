@@ -0,0 +1,393 @@
+#pragma once
+
+#include <cstddef>
+#include <stdexcept>
+#include <type_traits>
+
+namespace notlab {
+
+template <typename T> class Matrix;
+template <typename T> class Vector;
+
+/**
+ * @class VectorView
+ * @tparam T Element type, const qualified for read-only views.
+ * @brief Non-owning strided view of elements (1-based indexing).
+ * @details
+ *   Used for rows and columns of a Matrix or parts of a Vector without
+ *   copying. The viewed container must outlive the view and must not be
+ *   resized while the view is used.
+ */
+template <typename T> class VectorView {
+private:
+  T *m_data;
+  size_t m_size;
+  size_t m_stride;
+
+public:
+  using value_type = std::remove_const_t<T>;
+
+  /**
+   * @brief Creates view of size elements starting at data.
+   * @param data Pointer to the first element.
+   * @param size Number of elements.
+   * @param stride Distance between consecutive elements.
+   */
+  VectorView(T *data, size_t size, size_t stride = 1)
+      : m_data(data), m_size(size), m_stride(stride) {}
+
+  /**
+   * @brief Converts writable view to read-only view.
+   */
+  template <typename U>
+    requires std::is_same_v<const U, T>
+  VectorView(const VectorView<U> &other)
+      : m_data(other.getRawData()), m_size(other.getSize()),
+        m_stride(other.getStride()) {}
+
+  size_t getSize() const { return m_size; }
+  size_t getStride() const { return m_stride; }
+  T *getRawData() const { return m_data; }
+
+  /**
+   * @brief Access the i-th element.
+   * @param i Index (starting from 1).
+   * @throws std::runtime_error if index is out of bounds.
+   * @return Reference to the element.
+   */
+  T &operator()(size_t i) const {
+    if (i > m_size || i < 1) {
+      throw std::runtime_error("Index out of bounds");
+    }
+    return m_data[(i - 1) * m_stride];
+  }
+
+  /**
+   * @brief Unchecked access for hot loops.
+   * @param i Index (starting from 0).
+   * @return Reference to the element.
+   */
+  T &operator[](size_t i) const { return m_data[i * m_stride]; }
+
+  /**
+   * @brief View of consecutive elements.
+   * @param from First element (starting from 1).
+   * @param length Number of elements.
+   * @throws std::runtime_error if range is out of bounds.
+   * @return VectorView<T> View of elements [from, from + length).
+   */
+  VectorView<T> subView(size_t from, size_t length) const {
+    if (from < 1 || from - 1 + length > m_size) {
+      throw std::runtime_error("Sub view out of bounds");
+    }
+    return VectorView<T>(m_data + (from - 1) * m_stride, length, m_stride);
+  }
+
+  /**
+   * @brief Sets every element to value.
+   */
+  void fill(const value_type &value) const {
+    for (size_t i = 0; i < m_size; i++) {
+      m_data[i * m_stride] = value;
+    }
+  }
+
+  /**
+   * @brief Copies elements of other view of the same size.
+   * @throws std::runtime_error if sizes don't match.
+   */
+  template <typename U> void copyFrom(const VectorView<U> &other) const {
+    if (other.getSize() != m_size) {
+      throw std::runtime_error("Length of vectors don't match");
+    }
+    for (size_t i = 0; i < m_size; i++) {
+      m_data[i * m_stride] = static_cast<value_type>(other[i]);
+    }
+  }
+
+  /**
+   * @brief Copies viewed elements into a new Vector.
+   */
+  Vector<value_type> toVector() const {
+    Vector<value_type> vector = Vector<value_type>::zeros(m_size);
+    value_type *data = vector.getRawData();
+    for (size_t i = 0; i < m_size; i++) {
+      data[i] = m_data[i * m_stride];
+    }
+    return vector;
+  }
+};
+
+/**
+ * @brief Dot product of two views of the same size.
+ * @throws std::runtime_error if sizes don't match.
+ */
+template <typename T, typename U>
+auto dot(const VectorView<T> &left, const VectorView<U> &right) {
+  if (left.getSize() != right.getSize()) {
+    throw std::runtime_error("Length of vectors don't match");
+  }
+  using resultType = decltype(left[0] * right[0]);
+  resultType sum = 0;
+  for (size_t i = 0; i < left.getSize(); i++) {
+    sum += left[i] * right[i];
+  }
+  return sum;
+}
+
+template <typename T> class MinorView;
+
+/**
+ * @class MatrixView
+ * @tparam T Element type, const qualified for read-only views.
+ * @brief Non-owning strided view of a matrix block (1-based indexing).
+ * @details
+ *   Element (row, col) lives at data[(row-1)*rowStride + (col-1)*colStride],
+ *   so rows, columns, blocks and transposes are all views of the same
+ *   storage. The viewed Matrix must outlive the view and must not be
+ *   resized while the view is used.
+ */
+template <typename T> class MatrixView {
+private:
+  T *m_data;
+  size_t m_numOfRows;
+  size_t m_numOfCols;
+  size_t m_rowStride;
+  size_t m_colStride;
+
+public:
+  using value_type = std::remove_const_t<T>;
+
+  /**
+   * @brief Creates view of rows x cols elements.
+   * @param data Pointer to element (1, 1).
+   * @param rows Number of rows.
+   * @param cols Number of columns.
+   * @param rowStride Distance between consecutive rows (default: cols).
+   * @param colStride Distance between consecutive columns.
+   */
+  MatrixView(T *data, size_t rows, size_t cols, size_t rowStride = 0,
+             size_t colStride = 1)
+      : m_data(data), m_numOfRows(rows), m_numOfCols(cols),
+        m_rowStride(rowStride ? rowStride : cols), m_colStride(colStride) {}
+
+  /**
+   * @brief Converts writable view to read-only view.
+   */
+  template <typename U>
+    requires std::is_same_v<const U, T>
+  MatrixView(const MatrixView<U> &other)
+      : m_data(other.getRawData()), m_numOfRows(other.getNumberOfRows()),
+        m_numOfCols(other.getNumberOfColums()),
+        m_rowStride(other.getRowStride()), m_colStride(other.getColStride()) {}
+
+  size_t getNumberOfRows() const { return m_numOfRows; }
+  size_t getNumberOfColums() const { return m_numOfCols; }
+  size_t getRowStride() const { return m_rowStride; }
+  size_t getColStride() const { return m_colStride; }
+  T *getRawData() const { return m_data; }
+  bool isSqure() const { return m_numOfRows == m_numOfCols; }
+
+  /**
+   * @brief Element access by (row, col).
+   * @param row Row number (1-based).
+   * @param col Column number (1-based).
+   * @throws std::runtime_error if index is out of bounds.
+   * @return Reference to element at (row, col).
+   */
+  T &operator()(size_t row, size_t col) const {
+    if (row == 0 || row > m_numOfRows || col == 0 || col > m_numOfCols) {
+      throw std::runtime_error("Index out of bounds");
+    }
+    return unchecked(row - 1, col - 1);
+  }
+
+  /**
+   * @brief Unchecked access for hot loops.
+   * @param row Row number (0-based).
+   * @param col Column number (0-based).
+   * @return Reference to element at (row, col).
+   */
+  T &unchecked(size_t row, size_t col) const {
+    return m_data[row * m_rowStride + col * m_colStride];
+  }
+
+  /**
+   * @brief View of one row.
+   * @param row Row number (1-based).
+   */
+  VectorView<T> row(size_t row) const {
+    if (row < 1 || row > m_numOfRows) {
+      throw std::runtime_error("Row out of bounds");
+    }
+    return VectorView<T>(m_data + (row - 1) * m_rowStride, m_numOfCols,
+                         m_colStride);
+  }
+
+  /**
+   * @brief View of one column.
+   * @param column Column number (1-based).
+   */
+  VectorView<T> column(size_t column) const {
+    if (column < 1 || column > m_numOfCols) {
+      throw std::runtime_error("column out of bounds");
+    }
+    return VectorView<T>(m_data + (column - 1) * m_colStride, m_numOfRows,
+                         m_rowStride);
+  }
+
+  /**
+   * @brief View of rectangular block.
+   * @param row First row of block (1-based).
+   * @param col First column of block (1-based).
+   * @param rows Number of rows of block.
+   * @param cols Number of columns of block.
+   * @throws std::runtime_error if block is out of bounds.
+   */
+  MatrixView<T> block(size_t row, size_t col, size_t rows, size_t cols) const {
+    if (row < 1 || col < 1 || row - 1 + rows > m_numOfRows ||
+        col - 1 + cols > m_numOfCols) {
+      throw std::runtime_error("Block out of bounds");
+    }
+    return MatrixView<T>(m_data + (row - 1) * m_rowStride +
+                             (col - 1) * m_colStride,
+                         rows, cols, m_rowStride, m_colStride);
+  }
+
+  /**
+   * @brief Transposed view of the same storage.
+   */
+  MatrixView<T> transposed() const {
+    return MatrixView<T>(m_data, m_numOfCols, m_numOfRows, m_colStride,
+                         m_rowStride);
+  }
+
+  /**
+   * @brief View without one row and one column.
+   * @param omitRow Row that is omited (1-based).
+   * @param omitColumn Column that is omited (1-based).
+   */
+  MinorView<T> minor(size_t omitRow, size_t omitColumn) const {
+    return MinorView<T>(*this, omitRow, omitColumn);
+  }
+
+  /**
+   * @brief Sets every element to value.
+   */
+  void fill(const value_type &value) const {
+    for (size_t row = 0; row < m_numOfRows; row++) {
+      for (size_t col = 0; col < m_numOfCols; col++) {
+        unchecked(row, col) = value;
+      }
+    }
+  }
+
+  /**
+   * @brief Copies elements of other view of the same shape.
+   * @throws std::runtime_error if shapes don't match.
+   */
+  template <typename V> void copyFrom(const V &other) const {
+    if (other.getNumberOfRows() != m_numOfRows ||
+        other.getNumberOfColums() != m_numOfCols) {
+      throw std::runtime_error("Numbers of columns or rows don't match up");
+    }
+    for (size_t row = 0; row < m_numOfRows; row++) {
+      for (size_t col = 0; col < m_numOfCols; col++) {
+        unchecked(row, col) =
+            static_cast<value_type>(other.unchecked(row, col));
+      }
+    }
+  }
+
+  /**
+   * @brief Copies viewed elements into a new Matrix.
+   */
+  Matrix<value_type> toMatrix() const {
+    Matrix<value_type> matrix =
+        Matrix<value_type>::zeros(m_numOfRows, m_numOfCols);
+    MatrixView<value_type>(matrix.getRawData(), m_numOfRows, m_numOfCols)
+        .copyFrom(*this);
+    return matrix;
+  }
+};
+
+/**
+ * @class MinorView
+ * @tparam T Element type, const qualified for read-only views.
+ * @brief View of a matrix with one row and one column removed.
+ */
+template <typename T> class MinorView {
+private:
+  MatrixView<T> m_base;
+  size_t m_omitRow;
+  size_t m_omitColumn;
+
+public:
+  using value_type = std::remove_const_t<T>;
+
+  /**
+   * @brief Creates minor view of base.
+   * @param base Viewed matrix.
+   * @param omitRow Row that is omited (1-based).
+   * @param omitColumn Column that is omited (1-based).
+   * @throws std::runtime_error if row or column is out of bounds.
+   */
+  MinorView(const MatrixView<T> &base, size_t omitRow, size_t omitColumn)
+      : m_base(base), m_omitRow(omitRow - 1), m_omitColumn(omitColumn - 1) {
+    if (base.getNumberOfRows() == 0 || base.getNumberOfColums() == 0) {
+      throw std::runtime_error("Can't calculate minor for empty matrix");
+    }
+    if (omitRow == 0 || omitRow > base.getNumberOfRows() || omitColumn == 0 ||
+        omitColumn > base.getNumberOfColums()) {
+      throw std::runtime_error(
+          "Index out of bound when calculation matrix minor");
+    }
+  }
+
+  size_t getNumberOfRows() const { return m_base.getNumberOfRows() - 1; }
+  size_t getNumberOfColums() const { return m_base.getNumberOfColums() - 1; }
+
+  /**
+   * @brief Element access by (row, col) of the minor.
+   * @param row Row number (1-based).
+   * @param col Column number (1-based).
+   * @throws std::runtime_error if index is out of bounds.
+   */
+  T &operator()(size_t row, size_t col) const {
+    if (row == 0 || row > getNumberOfRows() || col == 0 ||
+        col > getNumberOfColums()) {
+      throw std::runtime_error("Index out of bounds");
+    }
+    return unchecked(row - 1, col - 1);
+  }
+
+  /**
+   * @brief Unchecked access for hot loops.
+   * @param row Row number (0-based).
+   * @param col Column number (0-based).
+   */
+  T &unchecked(size_t row, size_t col) const {
+    return m_base.unchecked(row + (row >= m_omitRow),
+                            col + (col >= m_omitColumn));
+  }
+
+  /**
+   * @brief Copies minor into destination view of matching shape.
+   */
+  template <typename U> void copyTo(const MatrixView<U> &destination) const {
+    destination.copyFrom(*this);
+  }
+
+  /**
+   * @brief Copies minor into a new Matrix.
+   */
+  Matrix<value_type> toMatrix() const {
+    Matrix<value_type> matrix =
+        Matrix<value_type>::zeros(getNumberOfRows(), getNumberOfColums());
+    copyTo(MatrixView<value_type>(matrix.getRawData(), getNumberOfRows(),
+                                  getNumberOfColums()));
+    return matrix;
+  }
+};
+
+} // namespace notlab
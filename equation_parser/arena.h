@@ -0,0 +1,109 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <new>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace notlab
+{
+    /**
+     * @class ExpressionArena
+     * @brief Bump allocator owning all nodes of expression trees.
+     * @details
+     *   Memory comes from a few large blocks, objects are placed one after
+     *   another and never freed one by one. Everything is released at once
+     *   when arena is destroyed, so only trivially destructible objects can
+     *   be created. Pointers stay valid when arena is moved.
+     */
+    class ExpressionArena{
+        private:
+            std::vector<std::unique_ptr<std::byte[]>> m_blocks;
+            std::byte* m_current = nullptr;
+            size_t m_remaining = 0;
+            size_t m_bytesUsed = 0;
+
+            /// Size of one block, large enough for a typical formula.
+            static constexpr size_t s_blockSize = 4096;
+
+        public:
+            ExpressionArena() = default;
+            ExpressionArena(ExpressionArena&& other) noexcept
+            : m_blocks(std::move(other.m_blocks)), m_current(std::exchange(other.m_current, nullptr)),
+              m_remaining(std::exchange(other.m_remaining, 0)), m_bytesUsed(std::exchange(other.m_bytesUsed, 0)){}
+            ExpressionArena& operator=(ExpressionArena&& other) noexcept {
+                m_blocks = std::move(other.m_blocks);
+                m_current = std::exchange(other.m_current, nullptr);
+                m_remaining = std::exchange(other.m_remaining, 0);
+                m_bytesUsed = std::exchange(other.m_bytesUsed, 0);
+                return *this;
+            }
+            ExpressionArena(const ExpressionArena&) = delete;
+            ExpressionArena& operator=(const ExpressionArena&) = delete;
+
+            /**
+             * @brief Uninitialized memory for size bytes aligned to alignment.
+             */
+            void* allocate(size_t size, size_t alignment){
+                size_t padding = (alignment - reinterpret_cast<uintptr_t>(m_current) % alignment) % alignment;
+                if(!m_current || padding + size > m_remaining){
+                    size_t blockSize = std::max(s_blockSize, size + alignment);
+                    m_blocks.emplace_back(new std::byte[blockSize]);
+                    m_current = m_blocks.back().get();
+                    m_remaining = blockSize;
+                    padding = (alignment - reinterpret_cast<uintptr_t>(m_current) % alignment) % alignment;
+                }
+                void* memory = m_current + padding;
+                m_current += padding + size;
+                m_remaining -= padding + size;
+                m_bytesUsed += size;
+                return memory;
+            }
+
+            /**
+             * @brief Creates object in arena.
+             */
+            template<typename T, typename... Args>
+            T* make(Args&&... args){
+                static_assert(std::is_trivially_destructible_v<T>, "Arena never calls destructors");
+                return new (allocate(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+            }
+
+            /**
+             * @brief Array of n value-initialized elements in arena.
+             */
+            template<typename T>
+            T* makeArray(size_t n){
+                static_assert(std::is_trivially_destructible_v<T>, "Arena never calls destructors");
+                T* array = static_cast<T*>(allocate(sizeof(T) * std::max<size_t>(n, 1), alignof(T)));
+                std::uninitialized_value_construct_n(array, n);
+                return array;
+            }
+
+            /**
+             * @brief Copy of text kept alive by arena.
+             */
+            std::string_view copyString(std::string_view text){
+                char* copy = static_cast<char*>(allocate(std::max<size_t>(text.size(), 1), 1));
+                std::memcpy(copy, text.data(), text.size());
+                return std::string_view(copy, text.size());
+            }
+
+            /**
+             * @brief Bytes handed out, without alignment padding.
+             */
+            size_t getBytesUsed() const { return m_bytesUsed; }
+
+            /**
+             * @brief Number of blocks allocated from heap.
+             */
+            size_t getNumberOfBlocks() const { return m_blocks.size(); }
+    };
+
+} // namespace notlab
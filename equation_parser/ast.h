@@ -1,11 +1,13 @@
 #pragma once
 
 #include <vector>
-#include <memory>
 #include <map>
+#include <stdexcept>
 #include <string>
+#include <string_view>
 #include <cmath>
-#include <variant>
+#include "arena.h"
+#include "functions.h"
 
 namespace notlab
 {
@@ -13,67 +15,100 @@ namespace notlab
         None = 0, Plus, Minus, Multiplies, Divide, Power
     };
 
+    /**
+     * @brief Node of expression tree.
+     * @details
+     *   Nodes are created in ExpressionArena and freed together with it,
+     *   never one by one. Children are plain pointers into the same arena.
+     *   Nodes evaluate in float or double, each node implements both through
+     *   one evaluate template.
+     */
     struct Expression{
-        virtual ~Expression() {}
         virtual float eval(const std::map<std::string, float>& vars) const = 0;
+        virtual double eval(const std::map<std::string, double>& vars) const = 0;
+        protected:
+            ~Expression() = default;
+    };
+
+    /**
+     * @brief Array of child nodes allocated in arena.
+     */
+    struct ExpressionList{
+        Expression** items = nullptr;
+        size_t count = 0;
+
+        ExpressionList() = default;
+        ExpressionList(ExpressionArena& arena, size_t n): items(arena.makeArray<Expression*>(n)), count(n) {}
+
+        Expression** begin() const { return items; }
+        Expression** end() const { return items + count; }
+        size_t size() const { return count; }
+        Expression*& operator[](size_t i) const { return items[i]; }
     };
 
     struct Constant : Expression{
-        float value;
-        Constant(float v): value(v) {}
-        float eval(const std::map<std::string, float>& vars) const override {return value; }
+        /// Parsed and folded in double, rounded when evaluating in float.
+        double value;
+        Constant(double v): value(v) {}
+        template<typename T>
+        T evaluate(const std::map<std::string, T>&) const { return static_cast<T>(value); }
+        float eval(const std::map<std::string, float>& vars) const override { return evaluate(vars); }
+        double eval(const std::map<std::string, double>& vars) const override { return evaluate(vars); }
     };
 
     struct Variable: Expression{
-        std::string name;
-        Variable(const std::string& n): name(n) {}
-        float eval(const std::map<std::string, float>& vars) const override{
-            auto it = vars.find(name);
+        /// Points into arena of tree.
+        std::string_view name;
+        Variable(std::string_view n): name(n) {}
+        template<typename T>
+        T evaluate(const std::map<std::string, T>& vars) const {
+            auto it = vars.find(std::string(name));
             if(it == vars.end()){
                 throw std::runtime_error("Variable not found");
             }
             return it->second;
         }
+        float eval(const std::map<std::string, float>& vars) const override { return evaluate(vars); }
+        double eval(const std::map<std::string, double>& vars) const override { return evaluate(vars); }
     };
 
     struct Function : Expression{
-        std::string name;
-        std::vector<std::unique_ptr<Expression>> arguments;
-
-        Function(const std::string& n, std::vector<std::unique_ptr<Expression>> arg): name(n), arguments(std::move(arg)){}
-
-        float eval(const std::map<std::string, float>& vars) const override{ 
-            std::vector<float> argumentsValue;
-            argumentsValue.reserve(arguments.size());
-            for(auto& arg: arguments){
-                argumentsValue.push_back(arg->eval(vars));
+        /// Name of definition, valid for whole program.
+        std::string_view name;
+        ExpressionList arguments;
+        /// Resolved when node is created, never nullptr.
+        const FunctionDefinition* definition;
+
+        /**
+         * @throws std::runtime_error on unknown function or wrong number of arguments.
+         */
+        Function(std::string_view n, ExpressionList arg)
+        : Function(FunctionRegistry::instance().resolve(n, arg.size()), arg){}
+
+        Function(const FunctionDefinition& d, ExpressionList arg)
+        : name(d.name), arguments(arg), definition(&d){}
+
+        template<typename T>
+        T evaluate(const std::map<std::string, T>& vars) const {
+            T argumentsValue[FunctionDefinition::maxArity];
+            for(size_t i = 0; i < arguments.size(); i++){
+                argumentsValue[i] = arguments[i]->eval(vars);
             }
-
-            if(name == "sin"){
-                if(argumentsValue.size() != 1){
-                    throw std::runtime_error("sin: number of arguments is different than one");
-                }
-                return std::sin(argumentsValue[0]);
-            }
-            if(name == "max"){
-                if(argumentsValue.size() != 2){
-                    throw std::runtime_error("max: number of arguments is different than 2");
-                }
-                return std::max(argumentsValue[0], argumentsValue[1]);
-            }
-
-            throw std::runtime_error("Unknow function: " + name);
+            return definition->call(argumentsValue);
         }
+        float eval(const std::map<std::string, float>& vars) const override { return evaluate(vars); }
+        double eval(const std::map<std::string, double>& vars) const override { return evaluate(vars); }
     };
 
     struct UnaryOperator : Expression{
         Operator op;
-        std::unique_ptr<Expression> expression;
+        Expression* expression;
 
-        UnaryOperator(Operator o, std::unique_ptr<Expression> expr): op(o), expression(std::move(expr)){}
+        UnaryOperator(Operator o, Expression* expr): op(o), expression(expr){}
 
-        float eval(const std::map<std::string, float>& vars) const override{ 
-            float expressionValue = expression->eval(vars);
+        template<typename T>
+        T evaluate(const std::map<std::string, T>& vars) const {
+            T expressionValue = expression->eval(vars);
             switch (op)
             {
                 case Operator::Minus:
@@ -82,19 +117,22 @@ namespace notlab
                     throw std::runtime_error("Unknow operator");
             }
         }
+        float eval(const std::map<std::string, float>& vars) const override { return evaluate(vars); }
+        double eval(const std::map<std::string, double>& vars) const override { return evaluate(vars); }
     };
 
     struct BinaryOperator : Expression{
         Operator op;
-        std::unique_ptr<Expression> left;
-        std::unique_ptr<Expression> right;
+        Expression* left;
+        Expression* right;
 
-        BinaryOperator(Operator o, std::unique_ptr<Expression> l, std::unique_ptr<Expression> r)
-        :op(o), left(std::move(l)), right(std::move(r)){}
+        BinaryOperator(Operator o, Expression* l, Expression* r)
+        :op(o), left(l), right(r){}
 
-        float eval(const std::map<std::string, float>& vars) const override{
-            float leftValue = left->eval(vars);
-            float rightValue = right->eval(vars);
+        template<typename T>
+        T evaluate(const std::map<std::string, T>& vars) const {
+            T leftValue = left->eval(vars);
+            T rightValue = right->eval(vars);
             switch (op)
             {
                 case Operator::Plus:
@@ -113,7 +151,9 @@ namespace notlab
                 default:
                     throw std::runtime_error("Unknow operator");
             }
-        }  
+        }
+        float eval(const std::map<std::string, float>& vars) const override { return evaluate(vars); }
+        double eval(const std::map<std::string, double>& vars) const override { return evaluate(vars); }
     };
 
 } // namespace notlab
@@ -0,0 +1,963 @@
+#pragma once
+
+#include <cmath>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <vector>
+#include <algorithm>
+#include <map>
+#include <unordered_map>
+#include "ast.h"
+#include "functions.h"
+#include "optimizer.h"
+#include "../core/simd.h"
+#include "../core/simd_math.h"
+
+namespace notlab
+{
+    /**
+     * @struct Instruction
+     * @brief One bytecode instruction.
+     * @details
+     *   operand is index of constant for PushConstant, slot of variable for
+     *   LoadVariable, index of temporary for StoreTemporary/LoadTemporary,
+     *   index of output for StoreOutput and index of function for Call.
+     */
+    struct Instruction{
+        OpCode code;
+        uint32_t operand;
+    };
+
+    /**
+     * @class Bytecode
+     * @brief Flat postfix program compiled from one or more Expression trees.
+     * @details
+     *   Variables are resolved to slots at compile time, functions are already
+     *   resolved by the parser: built-in ones become their own opcode, others
+     *   are called through Call. Evaluation doesn't look up names or allocate.
+     *   Subexpressions occurring more than once and calling only pure functions
+     *   are computed once, kept in a temporary (StoreTemporary) and reused
+     *   (LoadTemporary), turning the tree into a DAG.
+     *   Several outputs compiled together share those subexpressions, each
+     *   output ends with StoreOutput.
+     *
+     *   run evaluates one sample. runBatch evaluates blocks of samples column
+     *   by column: every stack slot holds a whole block and each instruction
+     *   is one SIMD kernel over it. Batch results are bit-identical to run
+     *   (up to which NaN comes out of an operation on two NaNs): both compute
+     *   sin with the same polynomial (sinKernel, simdSin) and constant integer
+     *   powers by the same repeated multiplication, see getMultipliedExponent.
+     *   runDualBatch evaluates the same way and also
+     *   carries derivatives with respect to every variable.
+     *
+     *   run and runBatch evaluate in float or double, constants are kept in
+     *   both. Functions without FunctionDefinition::doubleScalar are computed
+     *   in float even in double evaluation. runDualBatch is float only.
+     */
+    class Bytecode{
+        private:
+            std::vector<Instruction> m_instructions;
+            std::vector<float> m_constants;
+            /// Same constants in double, used when evaluating in double.
+            std::vector<double> m_doubleConstants;
+            std::vector<const FunctionDefinition*> m_functions;
+            size_t m_stackSize = 0;
+            size_t m_depth = 0;
+            size_t m_numberOfTemporaries = 0;
+            size_t m_numberOfOutputs = 0;
+            size_t m_numberOfVariables = 0;
+            std::vector<std::string> m_sharedSubexpressions;
+
+            /// Text of every non-leaf subexpression and how many times it occurs.
+            struct CompileState{
+                std::unordered_map<const Expression*, std::string> keys;
+                std::map<std::string, size_t> occurrences;
+                std::map<std::string, uint32_t> temporaries;
+            };
+
+            template<typename T>
+            const std::vector<T>& constants() const {
+                if constexpr (std::is_same_v<T, float>){
+                    return m_constants;
+                }
+                else{
+                    return m_doubleConstants;
+                }
+            }
+
+            /// Samples evaluated together by runBatch.
+            static constexpr size_t s_batchSize = 256;
+            /// Largest constant integer exponent computed by multiplication.
+            static constexpr float s_maxMultipliedExponent = 64;
+
+            /**
+             * @brief base ^ exponent by squaring, same multiplications as block version below.
+             */
+            template<typename T>
+            static T powerByMultiplication(T base, unsigned exponent){
+                if(exponent == 0){
+                    return T(1);
+                }
+                T result = base;
+                bool first = true;
+                for(; exponent > 0; exponent >>= 1){
+                    if(exponent & 1){
+                        if(first){
+                            result = base;
+                            first = false;
+                        }
+                        else{
+                            result = result * base;
+                        }
+                    }
+                    if(exponent > 1){
+                        base = base * base;
+                    }
+                }
+                return result;
+            }
+
+            /**
+             * @brief result := result ^ exponent by squaring, base is scratch.
+             */
+            template<typename T>
+            static void powerByMultiplication(T* result, T* base, unsigned exponent, size_t length){
+                if(exponent == 0){
+                    std::fill(result, result + length, T(1));
+                    return;
+                }
+                std::copy(result, result + length, base);
+                bool first = true;
+                for(; exponent > 0; exponent >>= 1){
+                    if(exponent & 1){
+                        if(first){
+                            std::copy(base, base + length, result);
+                            first = false;
+                        }
+                        else{
+                            simdBinary<SimdOp::Multiply>(result, base, result, length);
+                        }
+                    }
+                    if(exponent > 1){
+                        simdBinary<SimdOp::Multiply>(base, base, base, length);
+                    }
+                }
+            }
+
+            /**
+             * @brief Applies function to blocks of arguments, argument a of sample i is arguments[a * argumentStride + i].
+             * @details Result replaces first argument.
+             */
+            template<typename T>
+            static void callBlock(const FunctionDefinition& function, T* arguments, size_t argumentStride, size_t length){
+                // Vectorized implementations are float only.
+                if constexpr (std::is_same_v<T, float>){
+                    if(function.vectorized){
+                        function.vectorized(arguments, argumentStride, arguments, length);
+                        return;
+                    }
+                }
+                T values[FunctionDefinition::maxArity];
+                for(size_t i = 0; i < length; i++){
+                    for(size_t a = 0; a < function.arity; a++){
+                        values[a] = arguments[a * argumentStride + i];
+                    }
+                    arguments[i] = function.call(values);
+                }
+            }
+
+            /**
+             * @brief Evaluates up to s_batchSize samples in precision T, slot k of stack is registers + k * s_batchSize.
+             * @details Output k of sample i is written to out[i * getNumberOfOutputs() + k].
+             */
+            template<typename T>
+            void runBlock(const T* variables, size_t variableStride, size_t length, T* registers, T* out) const {
+                size_t depth = 0;
+                auto slot = [registers](size_t index){ return registers + index * s_batchSize; };
+
+                for(size_t k = 0; k < m_instructions.size(); k++){
+                    const Instruction& instruction = m_instructions[k];
+                    switch (instruction.code)
+                    {
+                        case OpCode::PushConstant:{
+                            T* target = slot(depth++);
+                            std::fill(target, target + length, constants<T>()[instruction.operand]);
+                            break;
+                        }
+                        case OpCode::LoadVariable:{
+                            T* target = slot(depth++);
+                            const T* source = variables + instruction.operand;
+                            for(size_t i = 0; i < length; i++){
+                                target[i] = source[i * variableStride];
+                            }
+                            break;
+                        }
+                        case OpCode::StoreTemporary:
+                            std::copy(slot(depth - 1), slot(depth - 1) + length, slot(m_stackSize + instruction.operand));
+                            break;
+                        case OpCode::LoadTemporary:{
+                            const T* source = slot(m_stackSize + instruction.operand);
+                            std::copy(source, source + length, slot(depth++));
+                            break;
+                        }
+                        case OpCode::StoreOutput:{
+                            const T* source = slot(--depth);
+                            T* target = out + instruction.operand;
+                            for(size_t i = 0; i < length; i++){
+                                target[i * m_numberOfOutputs] = source[i];
+                            }
+                            break;
+                        }
+                        case OpCode::Negate:{
+                            // Negation, not * -1, which compilers may turn into it anyway and which keeps sign of NaN.
+                            T* target = slot(depth - 1);
+                            for(size_t i = 0; i < length; i++){
+                                target[i] = -target[i];
+                            }
+                            break;
+                        }
+                        case OpCode::Add:
+                            depth--;
+                            simdBinary<SimdOp::Add>(slot(depth - 1), slot(depth), slot(depth - 1), length);
+                            break;
+                        case OpCode::Subtract:
+                            depth--;
+                            simdBinary<SimdOp::Subtract>(slot(depth - 1), slot(depth), slot(depth - 1), length);
+                            break;
+                        case OpCode::Multiply:
+                            depth--;
+                            simdBinary<SimdOp::Multiply>(slot(depth - 1), slot(depth), slot(depth - 1), length);
+                            break;
+                        case OpCode::Divide:{
+                            depth--;
+                            const T* divisor = slot(depth);
+                            bool divisionByZero = false;
+                            for(size_t i = 0; i < length; i++){
+                                divisionByZero |= std::abs(divisor[i]) < 1e-8;
+                            }
+                            if(divisionByZero){
+                                throw std::runtime_error("Can't divided by zero");
+                            }
+                            simdDivide(slot(depth - 1), divisor, slot(depth - 1), length);
+                            break;
+                        }
+                        case OpCode::Power:{
+                            depth--;
+                            T* base = slot(depth - 1);
+                            T* exponent = slot(depth);
+                            int multipliedExponent = getMultipliedExponent<T>(k);
+                            if(multipliedExponent >= 0){
+                                powerByMultiplication(base, exponent, static_cast<unsigned>(multipliedExponent), length);
+                            }
+                            else{
+                                for(size_t i = 0; i < length; i++){
+                                    base[i] = std::pow(base[i], exponent[i]);
+                                }
+                            }
+                            break;
+                        }
+                        case OpCode::Sin:
+                            simdSin(slot(depth - 1), slot(depth - 1), length);
+                            break;
+                        case OpCode::Cos:{
+                            T* target = slot(depth - 1);
+                            for(size_t i = 0; i < length; i++){
+                                target[i] = std::cos(target[i]);
+                            }
+                            break;
+                        }
+                        case OpCode::Sqrt:
+                            simdSqrt(slot(depth - 1), slot(depth - 1), length);
+                            break;
+                        case OpCode::Log:{
+                            T* target = slot(depth - 1);
+                            for(size_t i = 0; i < length; i++){
+                                target[i] = std::log(target[i]);
+                            }
+                            break;
+                        }
+                        case OpCode::Step:{
+                            T* target = slot(depth - 1);
+                            for(size_t i = 0; i < length; i++){
+                                target[i] = target[i] >= 0 ? T(1) : T(0);
+                            }
+                            break;
+                        }
+                        case OpCode::Max:
+                            depth--;
+                            simdMax(slot(depth - 1), slot(depth), slot(depth - 1), length);
+                            break;
+                        case OpCode::Call:{
+                            const FunctionDefinition& function = *m_functions[instruction.operand];
+                            depth -= function.arity - 1;
+                            callBlock(function, slot(depth - 1), s_batchSize, length);
+                            break;
+                        }
+                    }
+                }
+            }
+
+            /**
+             * @brief Dual-number version of runBlock.
+             * @details
+             *   Slot k holds a value block followed by one tangent block per
+             *   variable, tangent v of a slot is its derivative with respect to
+             *   variable v. zero[k] marks slots whose tangents are all zero
+             *   (constants and what is computed only from them), their tangent
+             *   blocks are not read or written. Two blocks after the last slot
+             *   are scratch. Output k of sample i starts at
+             *   out[i * getNumberOfOutputs() * width + k * width], width = 1 + number of variables.
+             */
+            void runDualBlock(const float* variables, size_t variableStride, size_t length, float* registers, char* zero, float* out) const {
+                const size_t width = 1 + m_numberOfVariables;
+                size_t depth = 0;
+                auto value = [&](size_t index){ return registers + index * width * s_batchSize; };
+                auto tangent = [&](size_t index, size_t variable){ return value(index) + (1 + variable) * s_batchSize; };
+                float* scratch = value(m_stackSize + m_numberOfTemporaries);
+                float* scratch2 = scratch + s_batchSize;
+                auto copySlot = [&](size_t from, size_t to){
+                    size_t blocks = zero[from] ? 1 : width;
+                    for(size_t j = 0; j < blocks; j++){
+                        std::copy(value(from) + j * s_batchSize, value(from) + j * s_batchSize + length, value(to) + j * s_batchSize);
+                    }
+                    zero[to] = zero[from];
+                };
+                // tangents of slot *= factor, skipping zero tangents so 0 * inf stays 0.
+                auto chainRule = [&](size_t index, const float* factor){
+                    for(size_t v = 0; v < m_numberOfVariables; v++){
+                        float* target = tangent(index, v);
+                        for(size_t i = 0; i < length; i++){
+                            target[i] = target[i] != 0 ? target[i] * factor[i] : 0.0f;
+                        }
+                    }
+                };
+
+                for(size_t k = 0; k < m_instructions.size(); k++){
+                    const Instruction& instruction = m_instructions[k];
+                    switch (instruction.code)
+                    {
+                        case OpCode::PushConstant:
+                            std::fill(value(depth), value(depth) + length, m_constants[instruction.operand]);
+                            zero[depth++] = 1;
+                            break;
+                        case OpCode::LoadVariable:{
+                            float* target = value(depth);
+                            const float* source = variables + instruction.operand;
+                            for(size_t i = 0; i < length; i++){
+                                target[i] = source[i * variableStride];
+                            }
+                            for(size_t v = 0; v < m_numberOfVariables; v++){
+                                std::fill(tangent(depth, v), tangent(depth, v) + length, v == instruction.operand ? 1.0f : 0.0f);
+                            }
+                            zero[depth++] = 0;
+                            break;
+                        }
+                        case OpCode::StoreTemporary:
+                            copySlot(depth - 1, m_stackSize + instruction.operand);
+                            break;
+                        case OpCode::LoadTemporary:
+                            copySlot(m_stackSize + instruction.operand, depth++);
+                            break;
+                        case OpCode::StoreOutput:{
+                            depth--;
+                            float* target = out + instruction.operand * width;
+                            size_t stride = m_numberOfOutputs * width;
+                            for(size_t j = 0; j < width; j++){
+                                const float* source = value(depth) + j * s_batchSize;
+                                for(size_t i = 0; i < length; i++){
+                                    target[i * stride + j] = j == 0 || !zero[depth] ? source[i] : 0.0f;
+                                }
+                            }
+                            break;
+                        }
+                        case OpCode::Negate:
+                            for(size_t j = 0; j < (zero[depth - 1] ? 1 : width); j++){
+                                float* target = value(depth - 1) + j * s_batchSize;
+                                for(size_t i = 0; i < length; i++){
+                                    target[i] = -target[i];
+                                }
+                            }
+                            break;
+                        case OpCode::Add:
+                        case OpCode::Subtract:{
+                            depth--;
+                            size_t a = depth - 1, b = depth;
+                            bool add = instruction.code == OpCode::Add;
+                            for(size_t j = 0; j < width; j++){
+                                float* left = value(a) + j * s_batchSize;
+                                const float* right = value(b) + j * s_batchSize;
+                                if(j > 0 && zero[b]){
+                                    break;
+                                }
+                                if(j > 0 && zero[a]){
+                                    simdScale(right, add ? 1.0f : -1.0f, left, length);
+                                }
+                                else if(add){
+                                    simdBinary<SimdOp::Add>(left, right, left, length);
+                                }
+                                else{
+                                    simdBinary<SimdOp::Subtract>(left, right, left, length);
+                                }
+                            }
+                            zero[a] = zero[a] && zero[b];
+                            break;
+                        }
+                        case OpCode::Multiply:{
+                            depth--;
+                            size_t a = depth - 1, b = depth;
+                            // (ab)' = a'b + ab'
+                            for(size_t v = 0; v < m_numberOfVariables && !(zero[a] && zero[b]); v++){
+                                if(zero[b]){
+                                    simdBinary<SimdOp::Multiply>(tangent(a, v), value(b), tangent(a, v), length);
+                                }
+                                else if(zero[a]){
+                                    simdBinary<SimdOp::Multiply>(value(a), tangent(b, v), tangent(a, v), length);
+                                }
+                                else{
+                                    simdBinary<SimdOp::Multiply>(value(a), tangent(b, v), scratch, length);
+                                    simdBinary<SimdOp::Multiply>(tangent(a, v), value(b), tangent(a, v), length);
+                                    simdBinary<SimdOp::Add>(tangent(a, v), scratch, tangent(a, v), length);
+                                }
+                            }
+                            simdBinary<SimdOp::Multiply>(value(a), value(b), value(a), length);
+                            zero[a] = zero[a] && zero[b];
+                            break;
+                        }
+                        case OpCode::Divide:{
+                            depth--;
+                            size_t a = depth - 1, b = depth;
+                            const float* divisor = value(b);
+                            bool divisionByZero = false;
+                            for(size_t i = 0; i < length; i++){
+                                divisionByZero |= std::abs(divisor[i]) < 1e-8;
+                            }
+                            if(divisionByZero){
+                                throw std::runtime_error("Can't divided by zero");
+                            }
+                            simdDivide(value(a), divisor, value(a), length);
+                            // (a/b)' = (a' - (a/b) * b') / b
+                            for(size_t v = 0; v < m_numberOfVariables && !(zero[a] && zero[b]); v++){
+                                if(!zero[b]){
+                                    simdBinary<SimdOp::Multiply>(value(a), tangent(b, v), scratch, length);
+                                    if(zero[a]){
+                                        simdScale(scratch, -1.0f, tangent(a, v), length);
+                                    }
+                                    else{
+                                        simdBinary<SimdOp::Subtract>(tangent(a, v), scratch, tangent(a, v), length);
+                                    }
+                                }
+                                simdDivide(tangent(a, v), divisor, tangent(a, v), length);
+                            }
+                            zero[a] = zero[a] && zero[b];
+                            break;
+                        }
+                        case OpCode::Power:{
+                            depth--;
+                            size_t a = depth - 1, b = depth;
+                            float* base = value(a);
+                            float* exponent = value(b);
+                            int multipliedExponent = getMultipliedExponent<float>(k);
+                            if(multipliedExponent >= 0){
+                                // (a^n)' = n * a^(n-1) * a'
+                                unsigned n = static_cast<unsigned>(multipliedExponent);
+                                float constantExponent = static_cast<float>(n);
+                                if(!zero[a] && n > 0){
+                                    std::copy(base, base + length, scratch);
+                                    powerByMultiplication(scratch, scratch2, n - 1, length);
+                                    simdScale(scratch, constantExponent, scratch, length);
+                                    for(size_t v = 0; v < m_numberOfVariables; v++){
+                                        simdBinary<SimdOp::Multiply>(tangent(a, v), scratch, tangent(a, v), length);
+                                    }
+                                }
+                                zero[a] = zero[a] || n == 0;
+                                powerByMultiplication(base, exponent, n, length);
+                                break;
+                            }
+                            // (a^b)' = b * a^(b-1) * a' + a^b * log(a) * b'
+                            if(!zero[a]){
+                                for(size_t i = 0; i < length; i++){
+                                    scratch[i] = exponent[i] * std::pow(base[i], exponent[i] - 1);
+                                }
+                                chainRule(a, scratch);
+                            }
+                            for(size_t i = 0; i < length; i++){
+                                scratch2[i] = std::pow(base[i], exponent[i]);
+                            }
+                            if(!zero[b]){
+                                for(size_t i = 0; i < length; i++){
+                                    scratch[i] = scratch2[i] * std::log(base[i]);
+                                }
+                                for(size_t v = 0; v < m_numberOfVariables; v++){
+                                    float* target = tangent(a, v);
+                                    const float* source = tangent(b, v);
+                                    for(size_t i = 0; i < length; i++){
+                                        float term = source[i] != 0 ? source[i] * scratch[i] : 0.0f;
+                                        target[i] = zero[a] ? term : target[i] + term;
+                                    }
+                                }
+                                zero[a] = 0;
+                            }
+                            std::copy(scratch2, scratch2 + length, base);
+                            break;
+                        }
+                        case OpCode::Sin:
+                            if(!zero[depth - 1]){
+                                for(size_t i = 0; i < length; i++){
+                                    scratch[i] = std::cos(value(depth - 1)[i]);
+                                }
+                                chainRule(depth - 1, scratch);
+                            }
+                            simdSin(value(depth - 1), value(depth - 1), length);
+                            break;
+                        case OpCode::Cos:{
+                            float* target = value(depth - 1);
+                            if(!zero[depth - 1]){
+                                for(size_t i = 0; i < length; i++){
+                                    scratch[i] = -std::sin(target[i]);
+                                }
+                                chainRule(depth - 1, scratch);
+                            }
+                            for(size_t i = 0; i < length; i++){
+                                target[i] = std::cos(target[i]);
+                            }
+                            break;
+                        }
+                        case OpCode::Sqrt:
+                            simdSqrt(value(depth - 1), value(depth - 1), length);
+                            if(!zero[depth - 1]){
+                                // sqrt(a)' = a' / (2 * sqrt(a))
+                                for(size_t i = 0; i < length; i++){
+                                    scratch[i] = 0.5f / value(depth - 1)[i];
+                                }
+                                chainRule(depth - 1, scratch);
+                            }
+                            break;
+                        case OpCode::Log:{
+                            float* target = value(depth - 1);
+                            if(!zero[depth - 1]){
+                                for(size_t i = 0; i < length; i++){
+                                    scratch[i] = 1.0f / target[i];
+                                }
+                                chainRule(depth - 1, scratch);
+                            }
+                            for(size_t i = 0; i < length; i++){
+                                target[i] = std::log(target[i]);
+                            }
+                            break;
+                        }
+                        case OpCode::Step:{
+                            float* target = value(depth - 1);
+                            for(size_t i = 0; i < length; i++){
+                                target[i] = target[i] >= 0 ? 1.0f : 0.0f;
+                            }
+                            zero[depth - 1] = 1;
+                            break;
+                        }
+                        case OpCode::Max:{
+                            depth--;
+                            size_t a = depth - 1, b = depth;
+                            // std::max(a, b) picks a unless a < b, so does its tangent.
+                            for(size_t v = 0; v < m_numberOfVariables && !(zero[a] && zero[b]); v++){
+                                float* target = tangent(a, v);
+                                const float* source = tangent(b, v);
+                                for(size_t i = 0; i < length; i++){
+                                    float left = zero[a] ? 0.0f : target[i];
+                                    float right = zero[b] ? 0.0f : source[i];
+                                    target[i] = value(a)[i] < value(b)[i] ? right : left;
+                                }
+                            }
+                            zero[a] = zero[a] && zero[b];
+                            simdMax(value(a), value(b), value(a), length);
+                            break;
+                        }
+                        case OpCode::Call:{
+                            const FunctionDefinition& function = *m_functions[instruction.operand];
+                            depth -= function.arity - 1;
+                            size_t first = depth - 1;
+                            bool constant = std::all_of(zero + first, zero + first + function.arity, [](char z){ return z != 0; });
+                            if(!constant){
+                                if(!function.partials){
+                                    throw std::runtime_error(function.name + ": no partial derivatives for forward mode");
+                                }
+                                float arguments[FunctionDefinition::maxArity];
+                                float partials[FunctionDefinition::maxArity];
+                                for(size_t i = 0; i < length; i++){
+                                    for(size_t a = 0; a < function.arity; a++){
+                                        arguments[a] = value(first + a)[i];
+                                    }
+                                    function.partials(arguments, partials);
+                                    for(size_t v = 0; v < m_numberOfVariables; v++){
+                                        float sum = 0;
+                                        for(size_t a = 0; a < function.arity; a++){
+                                            float t = zero[first + a] ? 0.0f : tangent(first + a, v)[i];
+                                            sum += t != 0 ? partials[a] * t : 0.0f;
+                                        }
+                                        tangent(first, v)[i] = sum;
+                                    }
+                                }
+                            }
+                            zero[first] = constant;
+                            callBlock(function, value(first), width * s_batchSize, length);
+                            break;
+                        }
+                    }
+                }
+            }
+
+            void emit(OpCode code, uint32_t operand, int stackChange){
+                m_instructions.push_back({code, operand});
+                m_depth += stackChange;
+                m_stackSize = std::max(m_stackSize, m_depth);
+            }
+
+            static bool isLeaf(const Expression& expression){
+                return dynamic_cast<const Constant*>(&expression) || dynamic_cast<const Variable*>(&expression);
+            }
+
+            /**
+             * @return bool Whether expression calls only pure functions.
+             */
+            bool countSubexpressions(const Expression& expression, CompileState& state){
+                if(isLeaf(expression)){
+                    return true;
+                }
+                bool pure = true;
+                if(auto function = dynamic_cast<const Function*>(&expression)){
+                    pure = function->definition->pure;
+                    for(auto& argument: function->arguments){
+                        pure = countSubexpressions(*argument, state) && pure;
+                    }
+                }
+                else if(auto unary = dynamic_cast<const UnaryOperator*>(&expression)){
+                    pure = countSubexpressions(*unary->expression, state);
+                }
+                else if(auto binary = dynamic_cast<const BinaryOperator*>(&expression)){
+                    pure = countSubexpressions(*binary->left, state);
+                    pure = countSubexpressions(*binary->right, state) && pure;
+                }
+                std::string key = expressionToString(expression);
+                // Impure calls, and everything containing them, are computed every time they occur.
+                if(pure){
+                    state.occurrences[key]++;
+                }
+                state.keys[&expression] = std::move(key);
+                return pure;
+            }
+
+            /**
+             * @brief Compiles node, or reuses its temporary if same subexpression was already computed.
+             */
+            void compile(const Expression& expression, const std::vector<std::string>& variables, CompileState& state){
+                if(isLeaf(expression)){
+                    compileNode(expression, variables, state);
+                    return;
+                }
+                const std::string& key = state.keys.at(&expression);
+                if(state.occurrences[key] < 2){
+                    compileNode(expression, variables, state);
+                    return;
+                }
+                auto temporary = state.temporaries.find(key);
+                if(temporary != state.temporaries.end()){
+                    emit(OpCode::LoadTemporary, temporary->second, 1);
+                    m_sharedSubexpressions.push_back(key);
+                    return;
+                }
+                compileNode(expression, variables, state);
+                state.temporaries[key] = m_numberOfTemporaries;
+                emit(OpCode::StoreTemporary, m_numberOfTemporaries++, 0);
+            }
+
+            void compileNode(const Expression& expression, const std::vector<std::string>& variables, CompileState& state){
+                if(auto constant = dynamic_cast<const Constant*>(&expression)){
+                    m_constants.push_back(static_cast<float>(constant->value));
+                    m_doubleConstants.push_back(constant->value);
+                    emit(OpCode::PushConstant, m_constants.size() - 1, 1);
+                }
+                else if(auto variable = dynamic_cast<const Variable*>(&expression)){
+                    auto it = std::find(variables.begin(), variables.end(), variable->name);
+                    if(it == variables.end()){
+                        throw std::runtime_error("Variable not found");
+                    }
+                    emit(OpCode::LoadVariable, it - variables.begin(), 1);
+                }
+                else if(auto function = dynamic_cast<const Function*>(&expression)){
+                    for(auto& argument: function->arguments){
+                        compile(*argument, variables, state);
+                    }
+                    const FunctionDefinition& definition = *function->definition;
+                    uint32_t operand = 0;
+                    if(definition.code == OpCode::Call){
+                        auto it = std::find(m_functions.begin(), m_functions.end(), &definition);
+                        operand = it - m_functions.begin();
+                        if(it == m_functions.end()){
+                            m_functions.push_back(&definition);
+                        }
+                    }
+                    emit(definition.code, operand, 1 - static_cast<int>(definition.arity));
+                }
+                else if(auto unary = dynamic_cast<const UnaryOperator*>(&expression)){
+                    compile(*unary->expression, variables, state);
+                    if(unary->op != Operator::Minus){
+                        throw std::runtime_error("Unknow operator");
+                    }
+                    emit(OpCode::Negate, 0, 0);
+                }
+                else if(auto binary = dynamic_cast<const BinaryOperator*>(&expression)){
+                    compile(*binary->left, variables, state);
+                    compile(*binary->right, variables, state);
+                    switch (binary->op)
+                    {
+                        case Operator::Plus:
+                            emit(OpCode::Add, 0, -1);
+                            break;
+                        case Operator::Minus:
+                            emit(OpCode::Subtract, 0, -1);
+                            break;
+                        case Operator::Multiplies:
+                            emit(OpCode::Multiply, 0, -1);
+                            break;
+                        case Operator::Divide:
+                            emit(OpCode::Divide, 0, -1);
+                            break;
+                        case Operator::Power:
+                            emit(OpCode::Power, 0, -1);
+                            break;
+                        default:
+                            throw std::runtime_error("Unknow operator");
+                    }
+                }
+                else{
+                    throw std::runtime_error("Unknow expression");
+                }
+            }
+
+        public:
+            Bytecode() = default;
+
+            /**
+             * @brief Compiles expression tree.
+             *
+             * @param expression Root of parsed expression.
+             * @param variables Names of variables, position in vector is slot of variable.
+             * @throws std::runtime_error on unknown variable, function or wrong number of arguments.
+             */
+            Bytecode(const Expression& expression, const std::vector<std::string>& variables)
+            : Bytecode(std::vector<const Expression*>{&expression}, variables){}
+
+            /**
+             * @brief Compiles several expressions into one program with shared subexpressions.
+             *
+             * @param outputs Roots of expressions, output k is outputs[k].
+             * @param variables Names of variables, position in vector is slot of variable.
+             * @throws std::runtime_error on unknown variable, function or wrong number of arguments.
+             */
+            Bytecode(const std::vector<const Expression*>& outputs, const std::vector<std::string>& variables){
+                CompileState state;
+                for(const Expression* output: outputs){
+                    countSubexpressions(*output, state);
+                }
+                m_numberOfOutputs = outputs.size();
+                m_numberOfVariables = variables.size();
+                for(size_t k = 0; k < outputs.size(); k++){
+                    compile(*outputs[k], variables, state);
+                    emit(OpCode::StoreOutput, k, -1);
+                }
+            }
+
+            const std::vector<Instruction>& getInstructions() const { return m_instructions; }
+            const std::vector<float>& getConstants() const { return m_constants; }
+
+            /**
+             * @brief Exponent of Power instruction k if it is computed by repeated multiplication, -1 if by std::pow.
+             * @details
+             *   Exponents pushed as constant integers 0 to s_maxMultipliedExponent are
+             *   multiplied out by squaring, in every evaluation and by NativeProgram.
+             *   T selects constants compared, float or double.
+             */
+            template<typename T>
+            int getMultipliedExponent(size_t k) const {
+                if(k == 0 || m_instructions[k - 1].code != OpCode::PushConstant){
+                    return -1;
+                }
+                T exponent = constants<T>()[m_instructions[k - 1].operand];
+                if(exponent >= 0 && exponent <= s_maxMultipliedExponent && exponent == std::floor(exponent)){
+                    return static_cast<int>(exponent);
+                }
+                return -1;
+            }
+
+            /**
+             * @brief Functions called by Call, operand of Call is index into this vector.
+             */
+            const std::vector<const FunctionDefinition*>& getFunctions() const { return m_functions; }
+
+            /**
+             * @brief Subexpressions loaded from a temporary instead of recomputed, one entry per reuse.
+             */
+            const std::vector<std::string>& getSharedSubexpressions() const { return m_sharedSubexpressions; }
+
+            /**
+             * @brief Number of values needed as scratch by run (stack and temporaries).
+             */
+            size_t getStackSize() const { return m_stackSize + m_numberOfTemporaries; }
+
+            /**
+             * @brief Number of values produced for every sample.
+             */
+            size_t getNumberOfOutputs() const { return m_numberOfOutputs; }
+
+            /**
+             * @brief Number of variable slots the program was compiled with.
+             */
+            size_t getNumberOfVariables() const { return m_numberOfVariables; }
+
+            /**
+             * @brief Evaluates program with one output for one sample.
+             *
+             * @param variables Values of variables, indexed by slot.
+             * @param stack Scratch of at least getStackSize() values.
+             * @return T Value of expression.
+             */
+            template<typename T>
+            T run(const T* variables, T* stack) const {
+                T value;
+                run(variables, stack, &value);
+                return value;
+            }
+
+            /**
+             * @brief Evaluates all outputs for one sample.
+             *
+             * @param variables Values of variables, indexed by slot.
+             * @param stack Scratch of at least getStackSize() values.
+             * @param outputs getNumberOfOutputs() values.
+             */
+            template<typename T>
+            void run(const T* variables, T* stack, T* outputs) const {
+                T* top = stack - 1;
+                T* temporaries = stack + m_stackSize;
+                for(size_t k = 0; k < m_instructions.size(); k++){
+                    const Instruction& instruction = m_instructions[k];
+                    switch (instruction.code)
+                    {
+                        case OpCode::PushConstant:
+                            *++top = constants<T>()[instruction.operand];
+                            break;
+                        case OpCode::LoadVariable:
+                            *++top = variables[instruction.operand];
+                            break;
+                        case OpCode::StoreTemporary:
+                            temporaries[instruction.operand] = *top;
+                            break;
+                        case OpCode::LoadTemporary:
+                            *++top = temporaries[instruction.operand];
+                            break;
+                        case OpCode::StoreOutput:
+                            outputs[instruction.operand] = *top--;
+                            break;
+                        case OpCode::Negate:
+                            *top = -*top;
+                            break;
+                        case OpCode::Add:
+                            top--;
+                            *top = top[0] + top[1];
+                            break;
+                        case OpCode::Subtract:
+                            top--;
+                            *top = top[0] - top[1];
+                            break;
+                        case OpCode::Multiply:
+                            top--;
+                            *top = top[0] * top[1];
+                            break;
+                        case OpCode::Divide:
+                            top--;
+                            if(std::abs(top[1]) < 1e-8){
+                                throw std::runtime_error("Can't divided by zero");
+                            }
+                            *top = top[0] / top[1];
+                            break;
+                        case OpCode::Power:{
+                            top--;
+                            int multipliedExponent = getMultipliedExponent<T>(k);
+                            *top = multipliedExponent >= 0 ? powerByMultiplication(top[0], static_cast<unsigned>(multipliedExponent))
+                                                           : std::pow(top[0], top[1]);
+                            break;
+                        }
+                        case OpCode::Sin:
+                            *top = sinKernel(*top);
+                            break;
+                        case OpCode::Cos:
+                            *top = std::cos(*top);
+                            break;
+                        case OpCode::Sqrt:
+                            *top = std::sqrt(*top);
+                            break;
+                        case OpCode::Log:
+                            *top = std::log(*top);
+                            break;
+                        case OpCode::Step:
+                            *top = *top >= 0 ? T(1) : T(0);
+                            break;
+                        case OpCode::Max:
+                            top--;
+                            *top = std::max(top[0], top[1]);
+                            break;
+                        case OpCode::Call:{
+                            const FunctionDefinition& function = *m_functions[instruction.operand];
+                            top -= function.arity - 1;
+                            *top = function.call(top);
+                            break;
+                        }
+                    }
+                }
+            }
+
+            /**
+             * @brief Evaluates program for many samples at once.
+             *
+             * @param variables Values of variables, variable v of sample i is variables[i * variableStride + v].
+             * @param variableStride Distance between samples (number of columns for row-major matrices).
+             * @param count Number of samples.
+             * @param out count x getNumberOfOutputs() row-major outputs, output k of sample i is out[i * getNumberOfOutputs() + k].
+             */
+            template<typename T>
+            void runBatch(const T* variables, size_t variableStride, size_t count, T* out) const {
+                std::vector<T> registers(getStackSize() * s_batchSize);
+                for(size_t from = 0; from < count; from += s_batchSize){
+                    size_t length = std::min(s_batchSize, count - from);
+                    runBlock(variables + from * variableStride, variableStride, length, registers.data(), out + from * m_numberOfOutputs);
+                }
+            }
+
+            /**
+             * @brief Evaluates program and its gradient for many samples, carrying dual numbers.
+             * @details
+             *   Every value travels with its derivatives with respect to all
+             *   variables (forward mode automatic differentiation), so one pass
+             *   gives the value and full gradient of every output. Values are
+             *   the same as from runBatch.
+             *
+             * @param variables Values of variables, variable v of sample i is variables[i * variableStride + v].
+             * @param variableStride Distance between samples (number of columns for row-major matrices).
+             * @param count Number of samples.
+             * @param out Row-major, sample i has for each output its value followed by
+             *            getNumberOfVariables() partial derivatives, getNumberOfOutputs() * (1 + getNumberOfVariables()) floats.
+             */
+            void runDualBatch(const float* variables, size_t variableStride, size_t count, float* out) const {
+                size_t width = 1 + m_numberOfVariables;
+                size_t slots = m_stackSize + m_numberOfTemporaries;
+                std::vector<float> registers((slots * width + 2) * s_batchSize);
+                std::vector<char> zero(slots);
+                for(size_t from = 0; from < count; from += s_batchSize){
+                    size_t length = std::min(s_batchSize, count - from);
+                    runDualBlock(variables + from * variableStride, variableStride, length, registers.data(), zero.data(),
+                                 out + from * m_numberOfOutputs * width);
+                }
+            }
+    };
+
+} // namespace notlab
@@ -0,0 +1,238 @@
+#pragma once
+
+#include <cmath>
+#include <stdexcept>
+#include <string>
+#include "arena.h"
+#include "ast.h"
+#include "optimizer.h"
+
+namespace notlab
+{
+    namespace detail
+    {
+        inline bool isZero(const Expression& expression){
+            return isConstantEqual(expression, 0);
+        }
+
+        inline Expression* makeConstant(double value, ExpressionArena& arena){
+            return arena.make<Constant>(value);
+        }
+
+        inline Expression* makeFunction(const char* name, Expression* argument, ExpressionArena& arena){
+            ExpressionList arguments(arena, 1);
+            arguments[0] = argument;
+            return arena.make<Function>(name, arguments);
+        }
+
+        inline Expression* makeNegate(Expression* expression, ExpressionArena& arena){
+            if(isZero(*expression)){
+                return expression;
+            }
+            return arena.make<UnaryOperator>(Operator::Minus, expression);
+        }
+
+        inline Expression* makeSum(Expression* left, Expression* right, ExpressionArena& arena){
+            if(isZero(*left)){
+                return right;
+            }
+            if(isZero(*right)){
+                return left;
+            }
+            return arena.make<BinaryOperator>(Operator::Plus, left, right);
+        }
+
+        inline Expression* makeDifference(Expression* left, Expression* right, ExpressionArena& arena){
+            if(isZero(*right)){
+                return left;
+            }
+            if(isZero(*left)){
+                return makeNegate(right, arena);
+            }
+            return arena.make<BinaryOperator>(Operator::Minus, left, right);
+        }
+
+        /**
+         * @brief Product where structural zero (no dependence on variable) stays exact zero.
+         */
+        inline Expression* makeProduct(Expression* left, Expression* right, ExpressionArena& arena){
+            if(isZero(*left) || isZero(*right)){
+                return makeConstant(0, arena);
+            }
+            return arena.make<BinaryOperator>(Operator::Multiplies, left, right);
+        }
+
+        inline Expression* makeQuotient(Expression* left, Expression* right, ExpressionArena& arena){
+            if(isZero(*left)){
+                return left;
+            }
+            return arena.make<BinaryOperator>(Operator::Divide, left, right);
+        }
+
+        inline Expression* makePower(Expression* base, Expression* exponent, ExpressionArena& arena){
+            return arena.make<BinaryOperator>(Operator::Power, base, exponent);
+        }
+
+        inline Expression* differentiate(const Expression& expression, const std::string& variable, ExpressionArena& arena);
+
+        /**
+         * @brief a' * step(a - b) + b' * (1 - step(a - b)), with b - a inside step when swapped.
+         */
+        inline Expression* differentiateSelection(const Expression& a, const Expression& b, bool swapped,
+                                                  const std::string& variable, ExpressionArena& arena){
+            auto selector = [&]{
+                Expression* difference = swapped ? makeDifference(cloneExpression(b, arena), cloneExpression(a, arena), arena)
+                                                 : makeDifference(cloneExpression(a, arena), cloneExpression(b, arena), arena);
+                return makeFunction("step", difference, arena);
+            };
+            Expression* left = makeProduct(differentiate(a, variable, arena), selector(), arena);
+            Expression* right = makeProduct(differentiate(b, variable, arena),
+                                            makeDifference(makeConstant(1, arena), selector(), arena), arena);
+            return makeSum(left, right, arena);
+        }
+
+        inline Expression* differentiateFunction(const Function& function, const std::string& variable, ExpressionArena& arena){
+            const ExpressionList& arguments = function.arguments;
+            if(function.name == "max"){
+                // std::max(a, b) picks a unless a < b.
+                return differentiateSelection(*arguments[0], *arguments[1], false, variable, arena);
+            }
+            if(function.name == "min"){
+                // std::min(a, b) picks a unless b < a.
+                return differentiateSelection(*arguments[0], *arguments[1], true, variable, arena);
+            }
+            if(function.name == "pow"){
+                BinaryOperator power(Operator::Power, arguments[0], arguments[1]);
+                return differentiate(power, variable, arena);
+            }
+            if(function.name == "atan2"){
+                // atan2(y, x)' = (x * y' - y * x') / (x^2 + y^2)
+                const Expression& y = *arguments[0];
+                const Expression& x = *arguments[1];
+                Expression* numerator = makeDifference(makeProduct(cloneExpression(x, arena), differentiate(y, variable, arena), arena),
+                                                       makeProduct(cloneExpression(y, arena), differentiate(x, variable, arena), arena), arena);
+                if(isZero(*numerator)){
+                    return numerator;
+                }
+                Expression* denominator = makeSum(makeProduct(cloneExpression(x, arena), cloneExpression(x, arena), arena),
+                                                  makeProduct(cloneExpression(y, arena), cloneExpression(y, arena), arena), arena);
+                return makeQuotient(numerator, denominator, arena);
+            }
+            if(arguments.size() != 1){
+                throw std::runtime_error("Can't differentiate function: " + std::string(function.name));
+            }
+
+            Expression* inner = differentiate(*arguments[0], variable, arena);
+            if(isZero(*inner)){
+                return inner;
+            }
+            const Expression& argument = *arguments[0];
+            Expression* outer;
+            if(function.name == "sin"){
+                outer = makeFunction("cos", cloneExpression(argument, arena), arena);
+            }
+            else if(function.name == "cos"){
+                outer = makeNegate(makeFunction("sin", cloneExpression(argument, arena), arena), arena);
+            }
+            else if(function.name == "tan"){
+                Expression* cosine = makeFunction("cos", cloneExpression(argument, arena), arena);
+                outer = makeQuotient(makeConstant(1, arena), makeProduct(cosine, cloneExpression(*cosine, arena), arena), arena);
+            }
+            else if(function.name == "exp"){
+                outer = cloneExpression(function, arena);
+            }
+            else if(function.name == "abs"){
+                outer = makeDifference(makeProduct(makeConstant(2, arena), makeFunction("step", cloneExpression(argument, arena), arena), arena),
+                                       makeConstant(1, arena), arena);
+            }
+            else if(function.name == "sqrt"){
+                return makeQuotient(inner, makeProduct(makeConstant(2, arena), makeFunction("sqrt", cloneExpression(argument, arena), arena), arena), arena);
+            }
+            else if(function.name == "log"){
+                return makeQuotient(inner, cloneExpression(argument, arena), arena);
+            }
+            else if(function.name == "step"){
+                return makeConstant(0, arena);
+            }
+            else{
+                throw std::runtime_error("Can't differentiate function: " + std::string(function.name));
+            }
+            return makeProduct(outer, inner, arena);
+        }
+
+        inline Expression* differentiate(const Expression& expression, const std::string& variable, ExpressionArena& arena){
+            if(dynamic_cast<const Constant*>(&expression)){
+                return makeConstant(0, arena);
+            }
+            if(auto var = dynamic_cast<const Variable*>(&expression)){
+                return makeConstant(var->name == variable ? 1 : 0, arena);
+            }
+            if(auto function = dynamic_cast<const Function*>(&expression)){
+                return differentiateFunction(*function, variable, arena);
+            }
+            if(auto unary = dynamic_cast<const UnaryOperator*>(&expression)){
+                return makeNegate(differentiate(*unary->expression, variable, arena), arena);
+            }
+            auto binary = dynamic_cast<const BinaryOperator*>(&expression);
+            if(!binary){
+                throw std::runtime_error("Unknow expression");
+            }
+
+            const Expression& left = *binary->left;
+            const Expression& right = *binary->right;
+            Expression* dLeft = differentiate(left, variable, arena);
+            Expression* dRight = differentiate(right, variable, arena);
+            switch (binary->op)
+            {
+                case Operator::Plus:
+                    return makeSum(dLeft, dRight, arena);
+                case Operator::Minus:
+                    return makeDifference(dLeft, dRight, arena);
+                case Operator::Multiplies:
+                    return makeSum(makeProduct(dLeft, cloneExpression(right, arena), arena),
+                                   makeProduct(cloneExpression(left, arena), dRight, arena), arena);
+                case Operator::Divide:
+                    // (l/r)' = (l' - (l/r) * r') / r, divides only by r like the primal.
+                    return makeQuotient(makeDifference(dLeft, makeProduct(cloneExpression(expression, arena), dRight, arena), arena),
+                                        cloneExpression(right, arena), arena);
+                case Operator::Power:{
+                    // (l^r)' = r * l^(r-1) * l' + l^r * log(l) * r'
+                    Expression* baseTerm = makeConstant(0, arena);
+                    if(!isZero(*dLeft)){
+                        Expression* exponent = makeDifference(cloneExpression(right, arena), makeConstant(1, arena), arena);
+                        baseTerm = makeProduct(makeProduct(cloneExpression(right, arena), makePower(cloneExpression(left, arena), exponent, arena), arena),
+                                               dLeft, arena);
+                    }
+                    Expression* exponentTerm = makeConstant(0, arena);
+                    if(!isZero(*dRight)){
+                        Expression* power = makePower(cloneExpression(left, arena), cloneExpression(right, arena), arena);
+                        exponentTerm = makeProduct(makeProduct(power, makeFunction("log", cloneExpression(left, arena), arena), arena),
+                                                   dRight, arena);
+                    }
+                    return makeSum(baseTerm, exponentTerm, arena);
+                }
+                default:
+                    throw std::runtime_error("Unknow operator");
+            }
+        }
+    } // namespace detail
+
+    /**
+     * @brief Symbolic derivative of expression with respect to variable.
+     * @details
+     *   Terms that don't depend on variable are dropped while the tree is
+     *   built, the result is then passed through optimizeExpression.
+     *   Derivatives of max, min and abs use step, derivative of step is 0.
+     *   Functions registered by user can't be differentiated symbolically.
+     *
+     * @param expression Expression to differentiate.
+     * @param variable Name of variable.
+     * @param arena Arena receiving nodes of derivative, may differ from arena of expression.
+     * @throws std::runtime_error for functions without known derivative.
+     * @return Expression* Simplified derivative.
+     */
+    inline Expression* differentiateExpression(const Expression& expression, const std::string& variable, ExpressionArena& arena){
+        return optimizeExpression(detail::differentiate(expression, variable, arena), arena);
+    }
+
+} // namespace notlab
@@ -0,0 +1,238 @@
+#pragma once
+
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <type_traits>
+
+namespace notlab
+{
+    /**
+     * @brief Instructions of stack machine evaluating compiled expressions.
+     */
+    enum class OpCode : uint8_t{
+        PushConstant = 0, LoadVariable, StoreTemporary, LoadTemporary, StoreOutput,
+        Negate, Add, Subtract, Multiply, Divide, Power, Sin, Cos, Sqrt, Log, Step, Max, Call
+    };
+
+    /**
+     * @struct FunctionDefinition
+     * @brief Function callable from equations, resolved by name when equation is parsed.
+     */
+    struct FunctionDefinition{
+        /// Value for arguments[0], ..., arguments[arity - 1].
+        using Scalar = std::function<float(const float* arguments)>;
+        /// Scalar in double precision.
+        using DoubleScalar = std::function<double(const double* arguments)>;
+        /// n samples at once, argument a of sample i is arguments[a * argumentStride + i]. out may equal arguments.
+        using Vectorized = std::function<void(const float* arguments, size_t argumentStride, float* out, size_t n)>;
+        /// partials[a] is derivative with respect to argument a.
+        using Partials = std::function<void(const float* arguments, float* partials)>;
+
+        /// Largest number of arguments of a function.
+        static constexpr size_t maxArity = 8;
+
+        std::string name;
+        size_t arity = 0;
+        Scalar scalar;
+        /// Optional, used when evaluating in double, otherwise arguments are rounded to float and scalar is called.
+        DoubleScalar doubleScalar;
+        /// Optional, used by batch evaluation instead of calling scalar per sample.
+        Vectorized vectorized;
+        /// Optional, needed for forward mode gradient of equations using function.
+        Partials partials;
+        /// Instruction evaluating function inline, OpCode::Call for everything not built into Bytecode.
+        OpCode code = OpCode::Call;
+        /// Same arguments always give same value and calling has no side effects.
+        /// Only calls of pure functions are folded to constants or computed once when repeated.
+        bool pure = false;
+
+        /**
+         * @brief Value for arity arguments in precision T (float or double).
+         */
+        template<typename T>
+        T call(const T* arguments) const {
+            if constexpr (std::is_same_v<T, float>){
+                return scalar(arguments);
+            }
+            else{
+                if(doubleScalar){
+                    return doubleScalar(arguments);
+                }
+                float rounded[maxArity];
+                for(size_t a = 0; a < arity; a++){
+                    rounded[a] = static_cast<float>(arguments[a]);
+                }
+                return scalar(rounded);
+            }
+        }
+    };
+
+    /**
+     * @class FunctionRegistry
+     * @brief Functions known to the parser.
+     * @details
+     *   Holds built-in functions (sin, cos, tan, exp, log, sqrt, abs, step,
+     *   min, max, pow, atan2) and ones registered by user. Definitions are
+     *   never removed or replaced, so pointers returned by find stay valid
+     *   for the whole program. Safe to use from many threads.
+     */
+    class FunctionRegistry{
+        private:
+            mutable std::mutex m_mutex;
+            std::map<std::string, std::unique_ptr<FunctionDefinition>, std::less<>> m_functions;
+
+            template<typename F>
+            static FunctionDefinition::Vectorized unaryLoop(F function){
+                return [function](const float* arguments, size_t, float* out, size_t n){
+                    for(size_t i = 0; i < n; i++){
+                        out[i] = function(arguments[i]);
+                    }
+                };
+            }
+
+            template<typename F>
+            static FunctionDefinition::Vectorized binaryLoop(F function){
+                return [function](const float* arguments, size_t argumentStride, float* out, size_t n){
+                    const float* second = arguments + argumentStride;
+                    for(size_t i = 0; i < n; i++){
+                        out[i] = function(arguments[i], second[i]);
+                    }
+                };
+            }
+
+            const FunctionDefinition& add(FunctionDefinition definition){
+                if(definition.name.empty() || !std::isalpha(static_cast<unsigned char>(definition.name[0]))
+                   || !std::all_of(definition.name.begin(), definition.name.end(), [](char c){ return std::isalnum(static_cast<unsigned char>(c)); })){
+                    throw std::runtime_error("Invalid function name: " + definition.name);
+                }
+                if(definition.arity == 0 || definition.arity > FunctionDefinition::maxArity){
+                    throw std::runtime_error(definition.name + ": number of arguments must be between 1 and " + std::to_string(FunctionDefinition::maxArity));
+                }
+                if(!definition.scalar){
+                    throw std::runtime_error(definition.name + ": function is empty");
+                }
+                std::lock_guard<std::mutex> lock(m_mutex);
+                auto& slot = m_functions[definition.name];
+                if(slot){
+                    throw std::runtime_error("Function already registered: " + definition.name);
+                }
+                slot = std::make_unique<FunctionDefinition>(std::move(definition));
+                return *slot;
+            }
+
+            /// function is generic over argument type, giving both scalar and doubleScalar.
+            template<typename F>
+            void addBuiltin(const std::string& name, size_t arity, OpCode code, F function,
+                            FunctionDefinition::Vectorized vectorized = nullptr, FunctionDefinition::Partials partials = nullptr){
+                FunctionDefinition definition;
+                definition.name = name;
+                definition.arity = arity;
+                definition.code = code;
+                definition.pure = true;
+                definition.scalar = [function](const float* a){ return static_cast<float>(function(a)); };
+                definition.doubleScalar = [function](const double* a){ return static_cast<double>(function(a)); };
+                definition.vectorized = std::move(vectorized);
+                definition.partials = std::move(partials);
+                add(std::move(definition));
+            }
+
+            FunctionRegistry(){
+                addBuiltin("sin", 1, OpCode::Sin, [](const auto* a){ return std::sin(a[0]); });
+                addBuiltin("cos", 1, OpCode::Cos, [](const auto* a){ return std::cos(a[0]); });
+                addBuiltin("sqrt", 1, OpCode::Sqrt, [](const auto* a){ return std::sqrt(a[0]); });
+                addBuiltin("log", 1, OpCode::Log, [](const auto* a){ return std::log(a[0]); });
+                addBuiltin("step", 1, OpCode::Step, [](const auto* a){ return a[0] >= 0 ? 1.0f : 0.0f; });
+                addBuiltin("max", 2, OpCode::Max, [](const auto* a){ return std::max(a[0], a[1]); });
+                addBuiltin("pow", 2, OpCode::Power, [](const auto* a){ return std::pow(a[0], a[1]); });
+
+                addBuiltin("tan", 1, OpCode::Call, [](const auto* a){ return std::tan(a[0]); },
+                           unaryLoop([](float x){ return std::tan(x); }),
+                           [](const float* a, float* p){ float c = std::cos(a[0]); p[0] = 1 / (c * c); });
+                addBuiltin("exp", 1, OpCode::Call, [](const auto* a){ return std::exp(a[0]); },
+                           unaryLoop([](float x){ return std::exp(x); }),
+                           [](const float* a, float* p){ p[0] = std::exp(a[0]); });
+                addBuiltin("abs", 1, OpCode::Call, [](const auto* a){ return std::abs(a[0]); },
+                           unaryLoop([](float x){ return std::abs(x); }),
+                           [](const float* a, float* p){ p[0] = a[0] >= 0 ? 1.0f : -1.0f; });
+                // std::min(a, b) picks a unless b < a.
+                addBuiltin("min", 2, OpCode::Call, [](const auto* a){ return std::min(a[0], a[1]); },
+                           binaryLoop([](float x, float y){ return std::min(x, y); }),
+                           [](const float* a, float* p){ p[0] = a[1] < a[0] ? 0.0f : 1.0f; p[1] = 1 - p[0]; });
+                addBuiltin("atan2", 2, OpCode::Call, [](const auto* a){ return std::atan2(a[0], a[1]); },
+                           binaryLoop([](float y, float x){ return std::atan2(y, x); }),
+                           [](const float* a, float* p){ float r = a[0] * a[0] + a[1] * a[1]; p[0] = a[1] / r; p[1] = -a[0] / r; });
+            }
+
+        public:
+            FunctionRegistry(const FunctionRegistry&) = delete;
+            FunctionRegistry& operator=(const FunctionRegistry&) = delete;
+
+            static FunctionRegistry& instance(){
+                static FunctionRegistry inst;
+                return inst;
+            }
+
+            /**
+             * @brief Makes function callable from equations parsed afterwards.
+             *
+             * @param name Name used in equations, letters and digits starting with letter.
+             * @param arity Number of arguments, 1 to FunctionDefinition::maxArity.
+             * @param scalar Computes value from arity arguments.
+             * @param vectorized Optional batch implementation, see FunctionDefinition::Vectorized.
+             * @param partials Optional derivatives with respect to arguments, needed by GradientMode::Forward.
+             * @param doubleScalar Optional double precision version of scalar, see FunctionDefinition::doubleScalar.
+             * @param pure Whether function is pure, see FunctionDefinition::pure.
+             * @throws std::runtime_error if name is taken or invalid, or arity out of range.
+             * @return const FunctionDefinition& Registered definition.
+             */
+            const FunctionDefinition& registerFunction(const std::string& name, size_t arity, FunctionDefinition::Scalar scalar,
+                                                       FunctionDefinition::Vectorized vectorized = nullptr,
+                                                       FunctionDefinition::Partials partials = nullptr,
+                                                       FunctionDefinition::DoubleScalar doubleScalar = nullptr,
+                                                       bool pure = false){
+                FunctionDefinition definition;
+                definition.name = name;
+                definition.arity = arity;
+                definition.pure = pure;
+                definition.scalar = std::move(scalar);
+                definition.doubleScalar = std::move(doubleScalar);
+                definition.vectorized = std::move(vectorized);
+                definition.partials = std::move(partials);
+                return add(std::move(definition));
+            }
+
+            /**
+             * @brief Definition of function, nullptr if name is unknown.
+             */
+            const FunctionDefinition* find(std::string_view name) const {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                auto it = m_functions.find(name);
+                return it == m_functions.end() ? nullptr : it->second.get();
+            }
+
+            /**
+             * @brief Definition of function called with numberOfArguments arguments.
+             * @throws std::runtime_error on unknown function or wrong number of arguments.
+             */
+            const FunctionDefinition& resolve(std::string_view name, size_t numberOfArguments) const {
+                const FunctionDefinition* definition = find(name);
+                if(!definition){
+                    throw std::runtime_error("Unknow function: " + std::string(name));
+                }
+                if(numberOfArguments != definition->arity){
+                    throw std::runtime_error(definition->name + ": number of arguments is different than " + std::to_string(definition->arity));
+                }
+                return *definition;
+            }
+    };
+
+} // namespace notlab
@@ -0,0 +1,452 @@
+#pragma once
+
+#include <cerrno>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "functions.h"
+#include "bytecode.h"
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <dlfcn.h>
+#include <fcntl.h>
+#include <spawn.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#define NOTLAB_NATIVE_SUPPORTED 1
+extern char** environ;
+#endif
+
+namespace notlab
+{
+    /**
+     * @class NativeProgram
+     * @brief Bytecode translated to C++, compiled by system compiler and loaded as shared library.
+     * @details
+     *   Every instruction becomes one statement on a local variable, so the
+     *   compiler sees one straight-line function per sample with no stack
+     *   or dispatch. Operations are the same as in Bytecode::run: sin calls
+     *   back sinKernel and constant integer powers are multiplied out in the
+     *   same order. The library is built with floating point contraction
+     *   off. Results are bit-identical to run and runBatch, except which NaN
+     *   comes out of an operation on two NaNs, as long as the code including
+     *   bytecode.h is built with -ffp-contract=off too (GCC and Clang contract
+     *   run and sinKernel into fma otherwise when targeting CPUs with fma).
+     *
+     *   Libraries are cached on disk, named after hash of generated source
+     *   and compiler command, so a formula is compiled once per user.
+     *   Compiler is $NOTLAB_CXX (default c++), flags $NOTLAB_JIT_FLAGS
+     *   (default -O2, split at whitespace), run directly without a shell. Directory $NOTLAB_JIT_CACHE (default notlab-jit in
+     *   $XDG_CACHE_HOME or ~/.cache, created with mode 0700). Only a directory
+     *   and libraries owned by the effective user and not writable by group
+     *   or others are trusted, anything else is compiled again into a private
+     *   temporary directory, removed when the program is unloaded. Functions
+     *   without their own opcode are called back through FunctionDefinition::scalar.
+     */
+    class NativeProgram{
+        private:
+            using Entry = int (*)(const float* variables, size_t variableStride, size_t count, float* out,
+                                  float (*call)(const void* function, const float* arguments), const void* const* functions,
+                                  float (*sine)(float));
+
+            std::shared_ptr<void> m_library;
+            Entry m_entry = nullptr;
+            std::vector<const FunctionDefinition*> m_functions;
+            std::string m_libraryPath;
+            bool m_ranCompiler = false;
+
+            static float callFunction(const void* function, const float* arguments){
+                return static_cast<const FunctionDefinition*>(function)->scalar(arguments);
+            }
+
+            static float sine(float x){
+                return sinKernel(x);
+            }
+
+            /**
+             * @brief Exact C++ literal of value, hexadecimal so nothing is lost.
+             */
+            static std::string floatLiteral(float value){
+                if(std::isnan(value)){
+                    return "__builtin_nanf(\"\")";
+                }
+                if(std::isinf(value)){
+                    return value > 0 ? "__builtin_inff()" : "(-__builtin_inff())";
+                }
+                char buffer[64];
+                std::snprintf(buffer, sizeof(buffer), "%af", value);
+                return buffer;
+            }
+
+            static std::string environment(const char* name, const char* fallback){
+                const char* value = std::getenv(name);
+                return value && *value ? value : fallback;
+            }
+
+#if defined(NOTLAB_NATIVE_SUPPORTED)
+            /**
+             * @brief Whether path is a directory (or regular file) owned by effective user that nobody else can write to.
+             * @details Symbolic links are not followed, so a link is never private.
+             */
+            static bool isPrivate(const std::filesystem::path& path, bool directory){
+                struct stat status;
+                if(::lstat(path.c_str(), &status) != 0){
+                    return false;
+                }
+                bool type = directory ? S_ISDIR(status.st_mode) : S_ISREG(status.st_mode);
+                return type && status.st_uid == ::geteuid() && (status.st_mode & (S_IWGRP | S_IWOTH)) == 0;
+            }
+
+            /**
+             * @brief Runs arguments[0] found in PATH with arguments, no shell, stdout and stderr go to logPath.
+             * @return int Exit status, 127 if program couldn't be started (reason is written to log).
+             */
+            static int runCompiler(const std::vector<std::string>& arguments, const std::filesystem::path& logPath){
+                std::vector<char*> argv;
+                for(const std::string& argument: arguments){
+                    argv.push_back(const_cast<char*>(argument.c_str()));
+                }
+                argv.push_back(nullptr);
+
+                posix_spawn_file_actions_t actions;
+                posix_spawn_file_actions_init(&actions);
+                posix_spawn_file_actions_addopen(&actions, STDOUT_FILENO, logPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0600);
+                posix_spawn_file_actions_adddup2(&actions, STDOUT_FILENO, STDERR_FILENO);
+                pid_t pid;
+                int error = posix_spawnp(&pid, argv[0], &actions, nullptr, argv.data(), environ);
+                posix_spawn_file_actions_destroy(&actions);
+                if(error != 0){
+                    std::ofstream(logPath) << "Can't run " << arguments[0] << ": " << std::strerror(error) << "\n";
+                    return 127;
+                }
+                int status;
+                while(::waitpid(pid, &status, 0) < 0){
+                    if(errno != EINTR){
+                        return 127;
+                    }
+                }
+                return WIFEXITED(status) ? WEXITSTATUS(status) : 128 + WTERMSIG(status);
+            }
+
+            /**
+             * @brief Cache directory described in class details, created with mode 0700 if missing.
+             * @return std::filesystem::path Empty if there is no home directory to put it in.
+             */
+            static std::filesystem::path cacheDirectory(){
+                std::filesystem::path directory = environment("NOTLAB_JIT_CACHE", "");
+                if(directory.empty()){
+                    std::string xdg = environment("XDG_CACHE_HOME", "");
+                    std::string home = environment("HOME", "");
+                    if(!xdg.empty() && xdg[0] == '/'){
+                        directory = std::filesystem::path(xdg) / "notlab-jit";
+                    }
+                    else if(!home.empty()){
+                        directory = std::filesystem::path(home) / ".cache" / "notlab-jit";
+                    }
+                    else{
+                        return {};
+                    }
+                }
+                std::error_code error;
+                std::filesystem::create_directories(directory.parent_path(), error);
+                ::mkdir(directory.c_str(), 0700);
+                return directory;
+            }
+#endif
+
+            /// FNV-1a, only used to name cache files.
+            static uint64_t hash(const std::string& text){
+                uint64_t h = 14695981039346656037ull;
+                for(unsigned char c: text){
+                    h = (h ^ c) * 1099511628211ull;
+                }
+                return h;
+            }
+
+        public:
+            /// Name of function exported by generated library.
+            static constexpr const char* s_entryName = "notlab_native_program";
+
+            /**
+             * @brief C++ source evaluating program for count samples, same layout as Bytecode::runBatch.
+             * @details Generated function returns 1 on division by zero, 0 otherwise.
+             */
+            static std::string generateSource(const Bytecode& bytecode){
+                const std::vector<Instruction>& instructions = bytecode.getInstructions();
+                const std::vector<float>& constants = bytecode.getConstants();
+                const std::vector<const FunctionDefinition*>& functions = bytecode.getFunctions();
+                size_t numberOfOutputs = bytecode.getNumberOfOutputs();
+
+                std::ostringstream body;
+                std::vector<size_t> stack;
+                size_t nextValue = 0;
+                auto value = [](size_t index){ return "v" + std::to_string(index); };
+                // New local holding expression, not pushed.
+                auto local = [&](const std::string& expression){
+                    body << "        const float " << value(nextValue) << " = " << expression << ";\n";
+                    return value(nextValue++);
+                };
+                auto push = [&](const std::string& expression){
+                    local(expression);
+                    stack.push_back(nextValue - 1);
+                };
+                auto pop = [&](){
+                    size_t top = stack.back();
+                    stack.pop_back();
+                    return value(top);
+                };
+
+                for(size_t k = 0; k < instructions.size(); k++){
+                    const Instruction& instruction = instructions[k];
+                    switch (instruction.code)
+                    {
+                        case OpCode::PushConstant:
+                            push(floatLiteral(constants[instruction.operand]));
+                            break;
+                        case OpCode::LoadVariable:
+                            push("sample[" + std::to_string(instruction.operand) + "]");
+                            break;
+                        case OpCode::StoreTemporary:
+                            body << "        const float t" << instruction.operand << " = " << value(stack.back()) << ";\n";
+                            break;
+                        case OpCode::LoadTemporary:
+                            push("t" + std::to_string(instruction.operand));
+                            break;
+                        case OpCode::StoreOutput:
+                            body << "        result[" << instruction.operand << "] = " << pop() << ";\n";
+                            break;
+                        case OpCode::Negate:
+                            push("-" + pop());
+                            break;
+                        case OpCode::Sin:
+                            push("sine(" + pop() + ")");
+                            break;
+                        case OpCode::Cos:
+                            push("std::cos(" + pop() + ")");
+                            break;
+                        case OpCode::Sqrt:
+                            push("std::sqrt(" + pop() + ")");
+                            break;
+                        case OpCode::Log:
+                            push("std::log(" + pop() + ")");
+                            break;
+                        case OpCode::Step:
+                            push(pop() + " >= 0 ? 1.0f : 0.0f");
+                            break;
+                        case OpCode::Call:{
+                            const FunctionDefinition& function = *functions[instruction.operand];
+                            std::vector<std::string> arguments(function.arity);
+                            for(size_t a = function.arity; a-- > 0;){
+                                arguments[a] = pop();
+                            }
+                            std::string array = "a" + std::to_string(nextValue);
+                            body << "        const float " << array << "[] = {";
+                            for(size_t a = 0; a < arguments.size(); a++){
+                                body << (a ? ", " : "") << arguments[a];
+                            }
+                            body << "};\n";
+                            push("call(functions[" + std::to_string(instruction.operand) + "], " + array + ")");
+                            break;
+                        }
+                        default:{
+                            std::string right = pop();
+                            std::string left = pop();
+                            switch (instruction.code)
+                            {
+                                case OpCode::Add: push(left + " + " + right); break;
+                                case OpCode::Subtract: push(left + " - " + right); break;
+                                case OpCode::Multiply: push(left + " * " + right); break;
+                                case OpCode::Divide:
+                                    body << "        if(std::abs(" << right << ") < 1e-8) return 1;\n";
+                                    push(left + " / " + right);
+                                    break;
+                                case OpCode::Power:{
+                                    int exponent = bytecode.getMultipliedExponent<float>(k);
+                                    if(exponent < 0){
+                                        push("std::pow(" + left + ", " + right + ")");
+                                        break;
+                                    }
+                                    if(exponent == 0){
+                                        push("1.0f");
+                                        break;
+                                    }
+                                    // Same multiplications as Bytecode::powerByMultiplication.
+                                    std::string base = left;
+                                    std::string result;
+                                    for(; exponent > 0; exponent >>= 1){
+                                        if(exponent & 1){
+                                            result = result.empty() ? base : local(result + " * " + base);
+                                        }
+                                        if(exponent > 1){
+                                            base = local(base + " * " + base);
+                                        }
+                                    }
+                                    push(result);
+                                    break;
+                                }
+                                case OpCode::Max: push("std::max(" + left + ", " + right + ")"); break;
+                                default:
+                                    throw std::runtime_error("Unknow operator");
+                            }
+                            break;
+                        }
+                    }
+                }
+
+                std::ostringstream source;
+                source << "#include <algorithm>\n#include <cmath>\n#include <cstddef>\n\n"
+                       << "extern \"C\" int " << s_entryName << "(const float* variables, std::size_t variableStride, std::size_t count, float* out,\n"
+                       << "    float (*call)(const void*, const float*), const void* const* functions, float (*sine)(float)){\n"
+                       << "    (void)call; (void)functions; (void)sine;\n"
+                       << "    for(std::size_t i = 0; i < count; i++){\n"
+                       << "        const float* sample = variables + i * variableStride;\n"
+                       << "        float* result = out + i * " << numberOfOutputs << ";\n"
+                       << "        (void)sample;\n"
+                       << body.str()
+                       << "    }\n    return 0;\n}\n";
+                return source.str();
+            }
+
+            NativeProgram() = default;
+
+            /**
+             * @brief Loads native version of bytecode, compiling it first unless it is in the disk cache.
+             * @throws std::runtime_error if compiler fails or library can't be loaded.
+             */
+            explicit NativeProgram(const Bytecode& bytecode)
+            : m_functions(bytecode.getFunctions()){
+#if defined(NOTLAB_NATIVE_SUPPORTED)
+                std::string source = generateSource(bytecode);
+                std::vector<std::string> arguments = {environment("NOTLAB_CXX", "c++"), "-std=c++17", "-shared", "-fPIC"};
+                std::istringstream flags(environment("NOTLAB_JIT_FLAGS", "-O2"));
+                for(std::string flag; flags >> flag;){
+                    arguments.push_back(flag);
+                }
+                // Contraction into fma would round differently than Bytecode::run.
+                arguments.push_back("-ffp-contract=off");
+                arguments.push_back("-fno-fast-math");
+
+                std::filesystem::path directory = cacheDirectory();
+                std::filesystem::path temporaryDirectory;
+                if(directory.empty() || !isPrivate(directory, true)){
+                    // Others could plant libraries there, compile into directory only this process uses.
+                    std::string pattern = (std::filesystem::temp_directory_path() / "notlab-jit-XXXXXX").string();
+                    if(!::mkdtemp(pattern.data())){
+                        throw std::runtime_error("Can't create directory for native program: " + pattern);
+                    }
+                    directory = temporaryDirectory = pattern;
+                }
+                try{
+                    load(source, arguments, directory, temporaryDirectory);
+                }
+                catch(...){
+                    if(!temporaryDirectory.empty()){
+                        std::error_code error;
+                        std::filesystem::remove_all(temporaryDirectory, error);
+                    }
+                    throw;
+                }
+#else
+                (void)bytecode;
+                throw std::runtime_error("Native programs aren't supported on this platform");
+#endif
+            }
+
+        private:
+#if defined(NOTLAB_NATIVE_SUPPORTED)
+            /**
+             * @brief Loads library of source from directory, compiling it first unless a private one is there.
+             * @param arguments Compiler and flags, source and output are appended.
+             * @param temporaryDirectory Removed when library is unloaded, empty for cache directory.
+             */
+            void load(const std::string& source, std::vector<std::string> arguments,
+                      const std::filesystem::path& directory, const std::filesystem::path& temporaryDirectory){
+                std::string command;
+                for(const std::string& argument: arguments){
+                    command += (command.empty() ? "" : " ") + argument;
+                }
+                char name[32];
+                std::snprintf(name, sizeof(name), "%016llx", static_cast<unsigned long long>(hash(command + '\n' + source)));
+                std::filesystem::path library = directory / (std::string(name) + ".so");
+
+                if(!isPrivate(library, false)){
+                    // Unique names, so processes compiling the same formula don't clash. rename is atomic.
+                    std::string unique = std::string(name) + "." + std::to_string(::getpid()) + "." + std::to_string(reinterpret_cast<uintptr_t>(this));
+                    std::filesystem::path sourcePath = directory / (unique + ".cpp");
+                    std::filesystem::path temporaryLibrary = directory / (unique + ".so");
+                    std::filesystem::path logPath = directory / (unique + ".log");
+                    std::ofstream(sourcePath) << source;
+                    arguments.insert(arguments.end(), {sourcePath.string(), "-o", temporaryLibrary.string()});
+                    int status = runCompiler(arguments, logPath);
+                    std::filesystem::remove(sourcePath);
+                    if(status != 0 || !std::filesystem::exists(temporaryLibrary)){
+                        std::stringstream log;
+                        log << std::ifstream(logPath).rdbuf();
+                        std::filesystem::remove(logPath);
+                        std::filesystem::remove(temporaryLibrary);
+                        throw std::runtime_error("Native compilation failed: " + command + " " + sourcePath.string()
+                                                 + " -o " + temporaryLibrary.string() + "\n" + log.str());
+                    }
+                    std::filesystem::remove(logPath);
+                    // Writable by owner only whatever umask is, so it is trusted next time. Replaces untrusted file.
+                    std::filesystem::permissions(temporaryLibrary, std::filesystem::perms::owner_all | std::filesystem::perms::group_read
+                                                 | std::filesystem::perms::group_exec | std::filesystem::perms::others_read
+                                                 | std::filesystem::perms::others_exec);
+                    std::filesystem::rename(temporaryLibrary, library);
+                    m_ranCompiler = true;
+                }
+
+                void* handle = dlopen(library.c_str(), RTLD_NOW | RTLD_LOCAL);
+                if(!handle){
+                    throw std::runtime_error(std::string("Can't load native program: ") + dlerror());
+                }
+                m_library = std::shared_ptr<void>(handle, [temporaryDirectory](void* h){
+                    dlclose(h);
+                    if(!temporaryDirectory.empty()){
+                        std::error_code error;
+                        std::filesystem::remove_all(temporaryDirectory, error);
+                    }
+                });
+                m_entry = reinterpret_cast<Entry>(dlsym(handle, s_entryName));
+                if(!m_entry){
+                    throw std::runtime_error("Can't find " + std::string(s_entryName) + " in " + library.string());
+                }
+                m_libraryPath = library.string();
+            }
+#endif
+
+        public:
+
+            /**
+             * @brief Evaluates program for many samples, same arguments and output as Bytecode::runBatch.
+             * @throws std::runtime_error on division by zero.
+             */
+            void run(const float* variables, size_t variableStride, size_t count, float* out) const {
+                if(m_entry(variables, variableStride, count, out, &NativeProgram::callFunction,
+                           reinterpret_cast<const void* const*>(m_functions.data()), &NativeProgram::sine) != 0){
+                    throw std::runtime_error("Can't divided by zero");
+                }
+            }
+
+            /**
+             * @brief Path of loaded library.
+             */
+            const std::string& getLibraryPath() const { return m_libraryPath; }
+
+            /**
+             * @brief Whether constructor had to run the compiler, false if library came from disk cache.
+             */
+            bool ranCompiler() const { return m_ranCompiler; }
+    };
+
+} // namespace notlab
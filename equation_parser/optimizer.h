@@ -0,0 +1,277 @@
+#pragma once
+
+#include <cmath>
+#include <charconv>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "arena.h"
+#include "ast.h"
+
+namespace notlab
+{
+    /**
+     * @struct OptimizationReport
+     * @brief What optimizeExpression and bytecode compilation removed.
+     */
+    struct OptimizationReport{
+        /// Constant subtrees replaced by their value.
+        size_t foldedConstants = 0;
+        /// Identities applied (x*1, x-0, x^2, ...).
+        size_t simplifiedIdentities = 0;
+        /// Repeated subexpressions computed once and reused.
+        size_t sharedSubexpressions = 0;
+        /// One line per change, "before -> after".
+        std::vector<std::string> changes;
+    };
+
+    /**
+     * @brief Symbol of binary operator.
+     */
+    inline const char* operatorSymbol(Operator op){
+        switch (op)
+        {
+            case Operator::Plus:
+                return "+";
+            case Operator::Minus:
+                return "-";
+            case Operator::Multiplies:
+                return "*";
+            case Operator::Divide:
+                return "/";
+            case Operator::Power:
+                return "^";
+            default:
+                throw std::runtime_error("Unknow operator");
+        }
+    }
+
+    /**
+     * @brief Fully parenthesized text of expression, equal for structurally equal trees.
+     */
+    inline std::string expressionToString(const Expression& expression){
+        if(auto constant = dynamic_cast<const Constant*>(&expression)){
+            // Shortest text reading back as the same double, also used as key of shared subexpressions.
+            char buffer[32];
+            auto result = std::to_chars(buffer, buffer + sizeof(buffer), constant->value);
+            return std::string(buffer, result.ptr);
+        }
+        if(auto variable = dynamic_cast<const Variable*>(&expression)){
+            return std::string(variable->name);
+        }
+        if(auto function = dynamic_cast<const Function*>(&expression)){
+            std::string text = std::string(function->name) + "(";
+            for(size_t i = 0; i < function->arguments.size(); i++){
+                text += (i ? "," : "") + expressionToString(*function->arguments[i]);
+            }
+            return text + ")";
+        }
+        if(auto unary = dynamic_cast<const UnaryOperator*>(&expression)){
+            return "-(" + expressionToString(*unary->expression) + ")";
+        }
+        if(auto binary = dynamic_cast<const BinaryOperator*>(&expression)){
+            return "(" + expressionToString(*binary->left) + operatorSymbol(binary->op) + expressionToString(*binary->right) + ")";
+        }
+        throw std::runtime_error("Unknow expression");
+    }
+
+    /**
+     * @brief Deep copy of expression tree into arena.
+     */
+    inline Expression* cloneExpression(const Expression& expression, ExpressionArena& arena){
+        if(auto constant = dynamic_cast<const Constant*>(&expression)){
+            return arena.make<Constant>(constant->value);
+        }
+        if(auto variable = dynamic_cast<const Variable*>(&expression)){
+            return arena.make<Variable>(arena.copyString(variable->name));
+        }
+        if(auto function = dynamic_cast<const Function*>(&expression)){
+            ExpressionList arguments(arena, function->arguments.size());
+            for(size_t i = 0; i < arguments.size(); i++){
+                arguments[i] = cloneExpression(*function->arguments[i], arena);
+            }
+            return arena.make<Function>(*function->definition, arguments);
+        }
+        if(auto unary = dynamic_cast<const UnaryOperator*>(&expression)){
+            return arena.make<UnaryOperator>(unary->op, cloneExpression(*unary->expression, arena));
+        }
+        if(auto binary = dynamic_cast<const BinaryOperator*>(&expression)){
+            return arena.make<BinaryOperator>(binary->op, cloneExpression(*binary->left, arena), cloneExpression(*binary->right, arena));
+        }
+        throw std::runtime_error("Unknow expression");
+    }
+
+    namespace detail
+    {
+        inline bool isConstant(const Expression& expression){
+            return dynamic_cast<const Constant*>(&expression) != nullptr;
+        }
+
+        inline bool isConstantEqual(const Expression& expression, double value){
+            auto constant = dynamic_cast<const Constant*>(&expression);
+            return constant && constant->value == value;
+        }
+
+        /**
+         * @brief Whether expression calls only pure functions, see FunctionDefinition::pure.
+         */
+        inline bool isPure(const Expression& expression){
+            if(auto function = dynamic_cast<const Function*>(&expression)){
+                if(!function->definition->pure){
+                    return false;
+                }
+                for(const Expression* argument: function->arguments){
+                    if(!isPure(*argument)){
+                        return false;
+                    }
+                }
+                return true;
+            }
+            if(auto unary = dynamic_cast<const UnaryOperator*>(&expression)){
+                return isPure(*unary->expression);
+            }
+            if(auto binary = dynamic_cast<const BinaryOperator*>(&expression)){
+                return isPure(*binary->left) && isPure(*binary->right);
+            }
+            return true;
+        }
+
+        /**
+         * @brief Whether expression is constant zero with given sign, x + (-0) and x - (+0) are exactly x.
+         */
+        inline bool isSignedZero(const Expression& expression, bool negative){
+            auto constant = dynamic_cast<const Constant*>(&expression);
+            return constant && constant->value == 0 && std::signbit(constant->value) == negative;
+        }
+
+        inline void record(OptimizationReport* report, size_t OptimizationReport::* counter,
+                           const std::string& before, const Expression& after){
+            (report->*counter)++;
+            report->changes.push_back(before + " -> " + expressionToString(after));
+        }
+
+        /**
+         * @brief Folds node with only constant children, keeps division by ~0 for runtime error.
+         */
+        inline Expression* foldConstant(Expression* expression, ExpressionArena& arena, OptimizationReport* report){
+            if(auto binary = dynamic_cast<BinaryOperator*>(expression)){
+                if(binary->op == Operator::Divide && std::abs(static_cast<Constant&>(*binary->right).value) < 1e-8){
+                    return expression;
+                }
+            }
+            Constant* folded = arena.make<Constant>(expression->eval(std::map<std::string, double>{}));
+            if(report){
+                record(report, &OptimizationReport::foldedConstants, expressionToString(*expression), *folded);
+            }
+            return folded;
+        }
+
+        /**
+         * @brief Applies identities to binary node whose children are already optimized.
+         */
+        inline Expression* simplifyBinary(BinaryOperator* binary, ExpressionArena& arena, OptimizationReport* report){
+            Expression* simplified = nullptr;
+            switch (binary->op)
+            {
+                // -0 + 0 is +0, so only adding -0 or subtracting +0 leaves every x unchanged.
+                case Operator::Plus:
+                    if(isSignedZero(*binary->right, true)){
+                        simplified = binary->left;
+                    }
+                    else if(isSignedZero(*binary->left, true)){
+                        simplified = binary->right;
+                    }
+                    break;
+                case Operator::Minus:
+                    if(isSignedZero(*binary->right, false)){
+                        simplified = binary->left;
+                    }
+                    break;
+                case Operator::Multiplies:
+                    if(isConstantEqual(*binary->right, 1)){
+                        simplified = binary->left;
+                    }
+                    else if(isConstantEqual(*binary->left, 1)){
+                        simplified = binary->right;
+                    }
+                    break;
+                case Operator::Divide:
+                    if(isConstantEqual(*binary->right, 1)){
+                        simplified = binary->left;
+                    }
+                    break;
+                case Operator::Power:
+                    if(isConstantEqual(*binary->right, 1)){
+                        simplified = binary->left;
+                    }
+                    // Duplicating impure base would call it twice.
+                    else if(isConstantEqual(*binary->right, 2) && isPure(*binary->left)){
+                        simplified = arena.make<BinaryOperator>(Operator::Multiplies, binary->left, cloneExpression(*binary->left, arena));
+                    }
+                    break;
+                default:
+                    break;
+            }
+            if(!simplified){
+                return binary;
+            }
+            if(report){
+                record(report, &OptimizationReport::simplifiedIdentities, expressionToString(*binary), *simplified);
+            }
+            return simplified;
+        }
+    } // namespace detail
+
+    /**
+     * @brief Optimizes expression tree bottom-up.
+     * @details
+     *   Folds subtrees without variables and impure calls (see
+     *   FunctionDefinition::pure) into constants and applies
+     *   identities x+(-0), (-0)+x, x-0, x*1, 1*x, x/1, x^1, x^2 -> x*x and
+     *   -(-x) -> x, all exact for every x. Identities that change results
+     *   for NaN, infinity or signed zero are not applied: x*0, x-x, x+0
+     *   (gives +0 for x = -0) and x^0.5 -> sqrt(x) (differs for x = -inf and
+     *   x = -0). Repeated subexpressions are shared later, when the tree is
+     *   compiled to Bytecode.
+     *
+     * @param expression Tree to optimize, rewritten in place.
+     * @param arena Arena of tree, new nodes are created there.
+     * @param report Collects what was changed, may be nullptr.
+     * @return Expression* Root of optimized tree.
+     */
+    inline Expression* optimizeExpression(Expression* expression, ExpressionArena& arena, OptimizationReport* report = nullptr){
+        if(auto function = dynamic_cast<Function*>(expression)){
+            bool allConstant = true;
+            for(Expression*& argument: function->arguments){
+                argument = optimizeExpression(argument, arena, report);
+                allConstant = allConstant && detail::isConstant(*argument);
+            }
+            return allConstant && function->definition->pure ? detail::foldConstant(expression, arena, report) : expression;
+        }
+        if(auto unary = dynamic_cast<UnaryOperator*>(expression)){
+            unary->expression = optimizeExpression(unary->expression, arena, report);
+            if(detail::isConstant(*unary->expression)){
+                return detail::foldConstant(expression, arena, report);
+            }
+            if(auto inner = dynamic_cast<UnaryOperator*>(unary->expression)){
+                if(unary->op == Operator::Minus && inner->op == Operator::Minus){
+                    if(report){
+                        detail::record(report, &OptimizationReport::simplifiedIdentities, expressionToString(*unary), *inner->expression);
+                    }
+                    return inner->expression;
+                }
+            }
+            return expression;
+        }
+        if(auto binary = dynamic_cast<BinaryOperator*>(expression)){
+            binary->left = optimizeExpression(binary->left, arena, report);
+            binary->right = optimizeExpression(binary->right, arena, report);
+            if(detail::isConstant(*binary->left) && detail::isConstant(*binary->right)){
+                return detail::foldConstant(expression, arena, report);
+            }
+            return detail::simplifyBinary(binary, arena, report);
+        }
+        return expression;
+    }
+
+} // namespace notlab
@@ -1,14 +1,13 @@
 #pragma once
 
 #include <algorithm>
-#include <memory>
 #include <vector>
 #include "ast.h"
 #include "tokenizer.h"
 
 namespace notlab{
 
-    int getOperatorPrecedence(const Token& operatorToken){
+    inline int getOperatorPrecedence(const Token& operatorToken){
         if(operatorToken.tokenContent == "^"){
             return 4;
         }
@@ -24,7 +23,7 @@ namespace notlab{
         return 0;
     }
 
-    Operator getOperatorFromString(const std::string& op){
+    inline Operator getOperatorFromString(std::string_view op){
         if(op == "+"){
             return Operator::Plus;
         }
@@ -45,35 +44,43 @@ namespace notlab{
         }
     }
 
-    static void pushToOperand(Token& op, std::vector<Token>& operatorStack, std::vector<std::unique_ptr<Expression>>& operandStack){
+    inline void pushToOperand(const Token& op, std::vector<Token>& operatorStack, std::vector<Expression*>& operandStack, ExpressionArena& arena){
             if(op.type == TokenType::UnaryMinus){
 
                 if(operandStack.empty()){
-                    throw std::runtime_error("Unary Minus: missing operand");
+                    throw syntaxError("Unary Minus: missing operand", op.position);
                 }
 
-                auto unaryArgument = std::move(operandStack.back());
+                Expression* unaryArgument = operandStack.back();
                 operandStack.pop_back();
-                operandStack.push_back(std::make_unique<UnaryOperator>(Operator::Minus, std::move(unaryArgument)));
+                operandStack.push_back(arena.make<UnaryOperator>(Operator::Minus, unaryArgument));
             }
             else{
 
                 if(operandStack.size() < 2){
-                    throw std::runtime_error("Binary operator: missing operands");
+                    throw syntaxError("Binary operator: missing operands", op.position);
                 }
 
-                auto right = std::move(operandStack.back());
+                Expression* right = operandStack.back();
                 operandStack.pop_back();
-                auto left = std::move(operandStack.back());
+                Expression* left = operandStack.back();
                 operandStack.pop_back();
                 Operator binaryOp = getOperatorFromString(op.tokenContent);
-                operandStack.push_back(std::make_unique<BinaryOperator>(binaryOp, std::move(left), std::move(right)));
+                operandStack.push_back(arena.make<BinaryOperator>(binaryOp, left, right));
             }
     } 
 
-    std::unique_ptr<Expression> parseTokens(const std::vector<Token>& tokens){
+    /**
+     * @brief Builds expression tree from tokens.
+     *
+     * @param tokens Tokens of equation.
+     * @param arena Arena receiving all nodes, tree lives as long as arena.
+     * @throws std::runtime_error on malformed equation, unknown function or wrong number of arguments.
+     * @return Expression* Root of tree.
+     */
+    inline Expression* parseTokens(const std::vector<Token>& tokens, ExpressionArena& arena){
         std::vector<Token> operatorStack;
-        std::vector<std::unique_ptr<Expression>> operandStack;
+        std::vector<Expression*> operandStack;
         std::vector<int> functionArgumentsCountStack;
 
         for(size_t i = 0; i<tokens.size(); i++){
@@ -81,12 +88,11 @@ namespace notlab{
             const Token& token = tokens[i];
             const Token* prevToken = (i > 0) ? &tokens[i-1] : nullptr;
 
-            std::cout << token.tokenContent << std::endl;
             if(token.type == TokenType::Number){
-                operandStack.push_back(std::make_unique<Constant>(std::stof(token.tokenContent)));
+                operandStack.push_back(arena.make<Constant>(token.value));
             }
             else if(token.type == TokenType::Variable){
-                operandStack.push_back(std::make_unique<Variable>(token.tokenContent));
+                operandStack.push_back(arena.make<Variable>(arena.copyString(token.tokenContent)));
             }
             else if(token.type == TokenType::Operator || token.type == TokenType::UnaryMinus){
 
@@ -101,7 +107,7 @@ namespace notlab{
                         Token op = operatorStack.back();
                         operatorStack.pop_back();
                     
-                        pushToOperand(op, operatorStack, operandStack);
+                        pushToOperand(op, operatorStack, operandStack, arena);
                     }
                     else{
                         break;
@@ -114,7 +120,7 @@ namespace notlab{
             }
             else if(token.type == TokenType::Comma){
                 if(functionArgumentsCountStack.empty()){
-                    throw std::runtime_error("Invalid use of token ','");
+                    throw syntaxError("Invalid use of token ','", token.position);
                 }
 
                 while(!operatorStack.empty() && operatorStack.back().type != TokenType::LeftParentheses){
@@ -122,49 +128,59 @@ namespace notlab{
                     operatorStack.pop_back();
 
 
-                    pushToOperand(op, operatorStack, operandStack);
+                    pushToOperand(op, operatorStack, operandStack, arena);
                 }
                 if(operatorStack.empty()){
-                    throw std::runtime_error("Comma without maching '('");
+                    throw syntaxError("Comma without maching '('", token.position);
                 }
                 functionArgumentsCountStack.back()++;
             }
-            else if(!operatorStack.empty() && token.type == TokenType::LeftParentheses){
-                if(operatorStack.back().type == TokenType::Function){
+            else if(token.type == TokenType::LeftParentheses){
+                if(!operatorStack.empty() && operatorStack.back().type == TokenType::Function){
                     functionArgumentsCountStack.push_back(0);
                 }
                 operatorStack.push_back(token);
             }
             else if(token.type == TokenType::RightParentheses){
-                while(operatorStack.back().type != TokenType::LeftParentheses){
+                while(!operatorStack.empty() && operatorStack.back().type != TokenType::LeftParentheses){
                     Token op = operatorStack.back();
                     operatorStack.pop_back();
 
-                    pushToOperand(op, operatorStack, operandStack);
+                    pushToOperand(op, operatorStack, operandStack, arena);
 
                     
+                }
+                if(operatorStack.empty()){
+                    throw syntaxError("Right parenthesis without maching '('", token.position);
                 }
                 operatorStack.pop_back();
 
 
-                if(operatorStack.back().type == TokenType::Function){
+                if(!operatorStack.empty() && operatorStack.back().type == TokenType::Function){
                     Token function = operatorStack.back();
                     operatorStack.pop_back();
 
                     if(prevToken && prevToken->type != TokenType::LeftParentheses && prevToken->type != TokenType::Comma){
                         functionArgumentsCountStack.back()++;
-                        std::cout << functionArgumentsCountStack.back() << std::endl;
                     }
 
-                    std::vector<std::unique_ptr<Expression>> arguments;
-
-                    for(int i = 0; i < functionArgumentsCountStack.back(); i++){
-                        arguments.push_back(std::move(operandStack.back()));
+                    int numberOfArguments = functionArgumentsCountStack.back();
+                    if(operandStack.size() < static_cast<size_t>(numberOfArguments)){
+                        throw syntaxError("Function: missing arguments", function.position);
+                    }
+                    ExpressionList arguments(arena, numberOfArguments);
+                    for(int i = numberOfArguments - 1; i >= 0; i--){
+                        arguments[i] = operandStack.back();
                         operandStack.pop_back();
                     }
-
-                    std::reverse(arguments.begin(), arguments.end());
-                    operandStack.push_back(std::make_unique<Function>(function.tokenContent, std::move(arguments))); 
+                    const FunctionDefinition* definition;
+                    try{
+                        definition = &FunctionRegistry::instance().resolve(function.tokenContent, arguments.size());
+                    }
+                    catch(const std::runtime_error& error){
+                        throw syntaxError(error.what(), function.position);
+                    }
+                    operandStack.push_back(arena.make<Function>(*definition, arguments));
 
                     functionArgumentsCountStack.pop_back();
                 }
@@ -175,13 +191,13 @@ namespace notlab{
             Token op = operatorStack.back();
                     operatorStack.pop_back();
 
-                    pushToOperand(op, operatorStack, operandStack);
+                    pushToOperand(op, operatorStack, operandStack, arena);
         }
 
 
         if(operandStack.size() != 1){
             throw std::runtime_error("Operand stack bad size");
         }
-        return std::move(operandStack.back());
+        return operandStack.back();
     }
 }
\ No newline at end of file
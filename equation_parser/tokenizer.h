@@ -1,28 +1,49 @@
 #pragma once
 
-#include <vector>
+#include <cctype>
+#include <charconv>
+#include <ostream>
+#include <stdexcept>
 #include <string>
+#include <string_view>
+#include <vector>
 
 namespace notlab{
-    
+
     enum class TokenType{
         None = 0, Number, Variable, Operator, LeftParentheses, RightParentheses, UnaryMinus, Function, Comma
     };
 
+    /**
+     * @struct Token
+     * @brief Slice of equation text.
+     * @details tokenContent points into the string passed to tokenize, which has to outlive the token.
+     */
     struct Token{
         TokenType type;
-        std::string tokenContent;
+        std::string_view tokenContent;
+        /// Parsed value of Number tokens.
+        double value = 0;
+        /// Offset of first character in equation.
+        size_t position = 0;
     };
 
-    bool isUnaryMinusAllowed(const std::vector<Token>& tokens) {
-    
+    /**
+     * @brief Error message with position of offending character.
+     */
+    inline std::runtime_error syntaxError(const std::string& message, size_t position){
+        return std::runtime_error(message + " at position " + std::to_string(position));
+    }
+
+    inline bool isUnaryMinusAllowed(const std::vector<Token>& tokens) {
+
         if (tokens.empty())
             return true;
         TokenType prev = tokens.back().type;
-        return prev == TokenType::Operator || prev == TokenType::LeftParentheses || prev == TokenType::UnaryMinus;
-    }  
+        return prev == TokenType::Operator || prev == TokenType::LeftParentheses || prev == TokenType::UnaryMinus || prev == TokenType::Comma;
+    }
 
-    bool isDigitAllowed(const std::vector<Token>& tokens){
+    inline bool isDigitAllowed(const std::vector<Token>& tokens){
         if(tokens.empty())
             return true;
 
@@ -31,7 +52,7 @@ namespace notlab{
         return prev == TokenType::Operator || prev == TokenType::LeftParentheses || prev == TokenType::UnaryMinus || prev == TokenType::Comma;
     }
 
-    bool isVariableAllowed(const std::vector<Token>& tokens){
+    inline bool isVariableAllowed(const std::vector<Token>& tokens){
         if(tokens.empty())
             return true;
 
@@ -40,7 +61,7 @@ namespace notlab{
         return prev == TokenType::Operator || prev == TokenType::LeftParentheses || prev == TokenType::UnaryMinus || prev == TokenType::Comma;
     }
 
-    bool isOperatorAllowed(const std::vector<Token>& tokens){
+    inline bool isOperatorAllowed(const std::vector<Token>& tokens){
         if(tokens.empty())
             return false;
 
@@ -49,114 +70,135 @@ namespace notlab{
         return prev == TokenType::RightParentheses || prev == TokenType::Number || prev == TokenType::Variable;
     }
 
-    bool isCommaAllowed(const std::vector<Token>& tokens){
+    inline bool isCommaAllowed(const std::vector<Token>& tokens){
         if(tokens.empty())
             return false;
 
         TokenType prev = tokens.back().type;
-        
+
         return prev == TokenType::Number || prev == TokenType::Variable || prev == TokenType::RightParentheses;
     }
 
-    void debugDump(const std::vector<Token>& tokens){
-        for(const Token token : tokens){
-            std::cout << token.tokenContent << std::endl;
+    inline void debugDump(const std::vector<Token>& tokens, std::ostream& stream){
+        for(const Token& token : tokens){
+            stream << token.position << ": " << token.tokenContent << std::endl;
+        }
+    }
+
+    /**
+     * @brief Appends names of variables in tokens missing from variables, in order of first occurrence.
+     */
+    inline void appendVariables(const std::vector<Token>& tokens, std::vector<std::string>& variables){
+        for(const Token& token: tokens){
+            if(token.type == TokenType::Variable){
+                bool known = false;
+                for(const std::string& variable: variables){
+                    known = known || variable == token.tokenContent;
+                }
+                if(!known){
+                    variables.emplace_back(token.tokenContent);
+                }
+            }
         }
     }
 
     /**
      * @brief Tokenizing equation string
-     * 
-     * @param equation String representing mathematical equation
+     * @details
+     *   Single pass without allocating anything but the returned vector.
+     *   Tokens are views into equation, numbers are parsed with std::from_chars.
+     *
+     * @param equation String representing mathematical equation, must outlive returned tokens.
+     * @throws std::runtime_error with position of offending character.
      * @return std::vector<Token> Vector of Tokens.
      */
-    std::vector<Token> tokenize(const std::string& equation){
+    inline std::vector<Token> tokenize(std::string_view equation){
         std::vector<Token> tokens;
+        // Every token takes at least one character.
+        tokens.reserve(equation.size());
 
         int levelOfParentheses = 0;
 
         size_t i = 0;
 
+        auto isDigit = [](char c){ return std::isdigit(static_cast<unsigned char>(c)) != 0; };
+        auto isAlpha = [](char c){ return std::isalpha(static_cast<unsigned char>(c)) != 0; };
 
         while(i < equation.size()){
-            if(std::isspace(equation[i])){
+            const char character = equation[i];
+            if(std::isspace(static_cast<unsigned char>(character))){
                 i++;
                 continue;
             }
 
-            if(std::isdigit(equation[i])){
+            if(isDigit(character)){
 
                 size_t digitStartPosition = i;
 
-                while(i < equation.size() && (std::isdigit(equation[i]) || equation[i] == '.')){
+                while(i < equation.size() && (isDigit(equation[i]) || equation[i] == '.')){
                     i++;
                 }
 
-                if(isDigitAllowed(tokens)){
-                    tokens.push_back({TokenType::Number, equation.substr(digitStartPosition, i-digitStartPosition)});
+                if(!isDigitAllowed(tokens)){
+                    throw syntaxError("Illegal character before number", digitStartPosition);
                 }
-                else{
-                    throw std::runtime_error(std::string("Illegal character before number: ") + equation[i]);
+                double value = 0;
+                auto [end, error] = std::from_chars(equation.data() + digitStartPosition, equation.data() + i, value);
+                if(error != std::errc() || end != equation.data() + i){
+                    throw syntaxError("Invalid number: " + std::string(equation.substr(digitStartPosition, i - digitStartPosition)), digitStartPosition);
                 }
-
+                tokens.push_back({TokenType::Number, equation.substr(digitStartPosition, i - digitStartPosition), value, digitStartPosition});
             }
 
-            else if(equation[i] == ','){
-                if(isCommaAllowed(tokens)){
-                    tokens.push_back({TokenType::Comma, ","});
-                }
-                else{
-                    throw std::runtime_error(std::string("Illegal character before number: ") + equation[i]);
+            else if(character == ','){
+                if(!isCommaAllowed(tokens)){
+                    throw syntaxError("Illegal character before ','", i);
                 }
+                tokens.push_back({TokenType::Comma, equation.substr(i, 1), 0, i});
                 i++;
             }
 
-            else if(std::isalpha(equation[i])){
+            else if(isAlpha(character)){
 
                 size_t variableStartPosition = i;
 
-                while(i < equation.size() && (std::isalpha(equation[i]) || std::isdigit(equation[i]))){
+                while(i < equation.size() && (isAlpha(equation[i]) || isDigit(equation[i]))){
                     i++;
                 }
 
-                std::string nameOfVariableOrFunction = equation.substr(variableStartPosition, i - variableStartPosition);
+                std::string_view nameOfVariableOrFunction = equation.substr(variableStartPosition, i - variableStartPosition);
 
-                if(isVariableAllowed(tokens)){
-                    if(i < equation.size() && equation[i] == '('){
-                        tokens.push_back({TokenType::Function, nameOfVariableOrFunction});
-                    }
-                    else{
-                        tokens.push_back({TokenType::Variable, nameOfVariableOrFunction});
-                    }
+                if(!isVariableAllowed(tokens)){
+                    throw syntaxError("Illegal character before variable", variableStartPosition);
+                }
+                if(i < equation.size() && equation[i] == '('){
+                    tokens.push_back({TokenType::Function, nameOfVariableOrFunction, 0, variableStartPosition});
                 }
                 else{
-                    throw std::runtime_error(std::string("Illegal character before variable: ") + equation[i]);
+                    tokens.push_back({TokenType::Variable, nameOfVariableOrFunction, 0, variableStartPosition});
                 }
             }
 
-            else if(equation[i] == '+' ||  equation[i] == '*' || equation[i] == '/' || equation[i] == '^'){
-                if(isOperatorAllowed(tokens)){
-                    tokens.push_back({TokenType::Operator, std::string(1, equation[i])});
-                }
-                else{
-                    throw std::runtime_error(std::string("Illegal character before operator: ") + equation[i]);
+            else if(character == '+' ||  character == '*' || character == '/' || character == '^'){
+                if(!isOperatorAllowed(tokens)){
+                    throw syntaxError(std::string("Illegal character before operator: ") + character, i);
                 }
-
+                tokens.push_back({TokenType::Operator, equation.substr(i, 1), 0, i});
                 i++;
             }
 
-            else if(equation[i] == '-'){
+            else if(character == '-'){
                 if(isUnaryMinusAllowed(tokens)){
-                    tokens.push_back({TokenType::UnaryMinus, "-"});
+                    tokens.push_back({TokenType::UnaryMinus, equation.substr(i, 1), 0, i});
                 }
                 else{
-                    tokens.push_back({TokenType::Operator, "-"});
+                    tokens.push_back({TokenType::Operator, equation.substr(i, 1), 0, i});
                 }
                 i++;
             }
 
-            else if (equation[i] == '('){
-                tokens.push_back({TokenType::LeftParentheses, "("});
+            else if (character == '('){
+                tokens.push_back({TokenType::LeftParentheses, equation.substr(i, 1), 0, i});
 
                 levelOfParentheses++;
 
@@ -164,32 +206,32 @@ namespace notlab{
                 i++;
             }
 
-            else if (equation[i] == ')'){
-                tokens.push_back({TokenType::RightParentheses, ")"});
+            else if (character == ')'){
+                tokens.push_back({TokenType::RightParentheses, equation.substr(i, 1), 0, i});
 
                 levelOfParentheses--;
                 if(levelOfParentheses < 0){
-                    throw std::runtime_error("Number of right paranthesies is greater than left");
+                    throw syntaxError("Number of right paranthesies is greater than left", i);
                 }
                 i++;
             }
 
             else{
-                throw std::runtime_error(std::string("Unknow character: ") + equation[i]);
+                throw syntaxError(std::string("Unknow character: ") + character, i);
             }
 
         }
 
         if(levelOfParentheses > 0 ){
-            throw std::runtime_error("Number of left paranthesies is greater than right");
+            throw syntaxError("Number of left paranthesies is greater than right", equation.size());
+        }
+        if(tokens.empty()){
+            throw std::runtime_error("Equation is empty");
         }
         if(tokens.back().type == TokenType::UnaryMinus || tokens.back().type == TokenType::Operator){
-            throw std::runtime_error("Operator can't be placed at the end of equation");
+            throw syntaxError("Operator can't be placed at the end of equation", tokens.back().position);
         }
 
-
-        //debugDump(tokens);
-
         return tokens;
     }
 
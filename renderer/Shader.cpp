@@ -53,6 +53,12 @@ void Shader::compile() {
   glDeleteShader(fragmentShader);
 }
 
+Shader::~Shader() {
+  if (m_programId != 0) {
+    glDeleteProgram(m_programId);
+  }
+}
+
 void Shader::bind() { glUseProgram(m_programId); }
 
 
@@ -14,7 +14,7 @@
  */
 class Shader {
 private:
-  unsigned int m_programId;
+  unsigned int m_programId = 0;
 
   unsigned int m_vertexId;
   unsigned int m_fragmentId;
@@ -41,6 +41,10 @@ private:
 public:
   Shader(const std::string &vertexS, const std::string &fragmentS)
       : m_vertexSource(vertexS), m_fragmentSource(fragmentS) {}
+  ~Shader();
+
+  Shader(const Shader &) = delete;
+  Shader &operator=(const Shader &) = delete;
 
   void compile();
 
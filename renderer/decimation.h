@@ -0,0 +1,259 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <vector>
+
+namespace notlab{
+
+    namespace detail{
+
+        /**
+         * @brief Samples [first, last) drawn for view [xBegin, xEnd], with one more on each side.
+         * @details x must be ascending, range is found by binary search.
+         */
+        inline void visibleRange(const float* x, size_t n, float xBegin, float xEnd, size_t& first, size_t& last){
+            first = std::lower_bound(x, x + n, xBegin) - x;
+            last = std::upper_bound(x, x + n, xEnd) - x;
+            if(first > 0){
+                first--;
+            }
+            if(last < n){
+                last++;
+            }
+        }
+
+        /**
+         * @brief Appends first, lowest, highest and last sample of bucket in increasing order, without repeats.
+         */
+        inline void appendBucket(size_t first, size_t lowest, size_t highest, size_t last, std::vector<size_t>& indices){
+            size_t kept[4] = {first, lowest, highest, last};
+            std::sort(kept, kept + 4);
+            for(size_t k = 0; k < 4; k++){
+                if(indices.empty() || indices.back() != kept[k]){
+                    indices.push_back(kept[k]);
+                }
+            }
+        }
+
+        /**
+         * @brief Pixel column of x, samples left and right of view fall into first and last column.
+         */
+        struct ColumnMapping{
+            float xBegin;
+            float columnsPerUnit;
+            size_t columns;
+
+            size_t operator()(float x) const {
+                float column = (x - xBegin) * columnsPerUnit;
+                return column < 0 ? size_t(0) : std::min(columns - 1, size_t(column));
+            }
+        };
+
+    }
+
+    /**
+     * @brief Picks samples of line plot needed to draw it on given number of pixel columns.
+     * @details
+     *   Samples with x in [xBegin, xEnd] are split into columns equally
+     *   wide buckets, each keeps its first, lowest, highest and last sample
+     *   (M4 aggregation). Line strip through kept samples covers the same
+     *   pixels as one through all samples, so shape of plot doesn't change.
+     *   Nearest sample outside the range on both sides is kept too, so the
+     *   line reaches edges of the view. When there are at most four samples
+     *   per column nothing is dropped.
+     *
+     * @param x Sorted ascending x of samples.
+     * @param y y of samples.
+     * @param n Number of samples.
+     * @param xBegin Smallest visible x.
+     * @param xEnd Largest visible x.
+     * @param columns Number of pixel columns between xBegin and xEnd.
+     * @param indices Replaced by indices of kept samples, ascending.
+     * @return bool Whether samples were dropped.
+     */
+    inline bool decimateMinMax(const float* x, const float* y, size_t n, float xBegin, float xEnd, size_t columns, std::vector<size_t>& indices){
+        indices.clear();
+        size_t first, last;
+        detail::visibleRange(x, n, xBegin, xEnd, first, last);
+        columns = std::max<size_t>(columns, 1);
+
+        if(last - first <= 4 * columns || xEnd <= xBegin){
+            for(size_t i = first; i < last; i++){
+                indices.push_back(i);
+            }
+            return false;
+        }
+
+        detail::ColumnMapping columnOf{xBegin, columns / (xEnd - xBegin), columns};
+        size_t bucket = columnOf(x[first]);
+        size_t bucketFirst = first, lowest = first, highest = first;
+        for(size_t i = first + 1; i < last; i++){
+            size_t column = columnOf(x[i]);
+            if(column != bucket){
+                detail::appendBucket(bucketFirst, lowest, highest, i - 1, indices);
+                bucket = column;
+                bucketFirst = lowest = highest = i;
+                continue;
+            }
+            if(y[i] < y[lowest]){
+                lowest = i;
+            }
+            if(y[i] > y[highest]){
+                highest = i;
+            }
+        }
+        detail::appendBucket(bucketFirst, lowest, highest, last - 1, indices);
+        return true;
+    }
+
+    /**
+     * @class SeriesPyramid
+     * @brief Min/max mip-map of series, answers lowest and highest sample of any index range in O(log n).
+     * @details
+     *   Level k stores for every aligned block of s_leafSize * 2^k samples
+     *   index of its lowest and highest sample, the first one on ties.
+     *   Built in O(n), samples appended later are added by extend in
+     *   amortized O(1) each. Takes about one byte per sample. decimate gives
+     *   the same samples as decimateMinMax, but in O(columns * log n)
+     *   instead of O(visible samples), so any zoom and pan costs the same.
+     */
+    class SeriesPyramid{
+        private:
+            /// Smaller ranges are scanned, so level 0 starts at this block size.
+            static constexpr size_t s_leafSize = 8;
+
+            std::vector<std::vector<uint32_t>> m_Lowest;
+            std::vector<std::vector<uint32_t>> m_Highest;
+
+        public:
+            /**
+             * @brief Builds all levels for y.
+             * @throws std::runtime_error if series has 2^32 or more samples.
+             */
+            void build(const float* y, size_t n){
+                m_Lowest.clear();
+                m_Highest.clear();
+                extend(y, n);
+            }
+
+            /**
+             * @brief Adds samples appended to y since last build or extend.
+             *
+             * @param y Series pyramid was built for, possibly reallocated since.
+             * @param n Number of samples in y now.
+             * @throws std::runtime_error if series has 2^32 or more samples.
+             */
+            void extend(const float* y, size_t n){
+                if(n > UINT32_MAX){
+                    throw std::runtime_error("Series is too long for SeriesPyramid");
+                }
+                size_t blocks = n / s_leafSize;
+                if(blocks == 0){
+                    return;
+                }
+                if(m_Lowest.empty()){
+                    m_Lowest.emplace_back();
+                    m_Highest.emplace_back();
+                }
+                for(size_t b = m_Lowest[0].size(); b < blocks; b++){
+                    uint32_t lowest = b * s_leafSize, highest = lowest;
+                    for(uint32_t i = lowest + 1; i < (b + 1) * s_leafSize; i++){
+                        if(y[i] < y[lowest]){
+                            lowest = i;
+                        }
+                        if(y[i] > y[highest]){
+                            highest = i;
+                        }
+                    }
+                    m_Lowest[0].push_back(lowest);
+                    m_Highest[0].push_back(highest);
+                }
+                for(size_t level = 0; m_Lowest[level].size() >= 2; level++){
+                    if(level + 1 == m_Lowest.size()){
+                        m_Lowest.emplace_back();
+                        m_Highest.emplace_back();
+                    }
+                    const std::vector<uint32_t>& lowerLowest = m_Lowest[level];
+                    const std::vector<uint32_t>& lowerHighest = m_Highest[level];
+                    std::vector<uint32_t>& lowest = m_Lowest[level + 1];
+                    std::vector<uint32_t>& highest = m_Highest[level + 1];
+                    for(size_t b = lowest.size(); b < lowerLowest.size() / 2; b++){
+                        uint32_t left = lowerLowest[2 * b], right = lowerLowest[2 * b + 1];
+                        lowest.push_back(y[right] < y[left] ? right : left);
+                        left = lowerHighest[2 * b];
+                        right = lowerHighest[2 * b + 1];
+                        highest.push_back(y[right] > y[left] ? right : left);
+                    }
+                }
+            }
+
+            /**
+             * @brief Indices of lowest and highest sample in [from, to), first ones on ties.
+             * @param y Series pyramid was built for.
+             */
+            void extremes(const float* y, size_t from, size_t to, size_t& lowest, size_t& highest) const {
+                lowest = highest = from;
+                auto take = [&](size_t low, size_t high){
+                    if(y[low] < y[lowest]){
+                        lowest = low;
+                    }
+                    if(y[high] > y[highest]){
+                        highest = high;
+                    }
+                };
+                size_t i = from;
+                while(i < to && i % s_leafSize != 0){
+                    take(i, i);
+                    i++;
+                }
+                // Largest aligned block starting at i that fits, block sizes grow and then shrink.
+                while(i + s_leafSize <= to){
+                    size_t level = 0;
+                    size_t block = i / s_leafSize;
+                    while(level + 1 < m_Lowest.size() && block % 2 == 0 && i + (s_leafSize << (level + 1)) <= to
+                          && block / 2 < m_Lowest[level + 1].size()){
+                        block /= 2;
+                        level++;
+                    }
+                    take(m_Lowest[level][block], m_Highest[level][block]);
+                    i += s_leafSize << level;
+                }
+                while(i < to){
+                    take(i, i);
+                    i++;
+                }
+            }
+
+            /**
+             * @brief Same as decimateMinMax, x and y must be the series pyramid was built for.
+             */
+            bool decimate(const float* x, const float* y, size_t n, float xBegin, float xEnd, size_t columns, std::vector<size_t>& indices) const {
+                indices.clear();
+                size_t first, last;
+                detail::visibleRange(x, n, xBegin, xEnd, first, last);
+                columns = std::max<size_t>(columns, 1);
+
+                if(last - first <= 4 * columns || xEnd <= xBegin){
+                    for(size_t i = first; i < last; i++){
+                        indices.push_back(i);
+                    }
+                    return false;
+                }
+
+                detail::ColumnMapping columnOf{xBegin, columns / (xEnd - xBegin), columns};
+                for(size_t from = first; from < last;){
+                    size_t column = columnOf(x[from]);
+                    size_t to = std::partition_point(x + from + 1, x + last, [&](float value){ return columnOf(value) <= column; }) - x;
+                    size_t lowest, highest;
+                    extremes(y, from, to, lowest, highest);
+                    detail::appendBucket(from, lowest, highest, to - 1, indices);
+                    from = to;
+                }
+                return true;
+            }
+    };
+
+}
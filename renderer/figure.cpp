@@ -1,5 +1,8 @@
 #include "figure.h"
+#include "resource_cache.h"
+#include <algorithm>
 #include <iostream>
+#include <numeric>
 #include <sstream>
 
 #include <glm/glm.hpp>
@@ -17,8 +20,8 @@ namespace notlab{
     m_Id = id;
   }
 
-  Figure::Figure(const std::string& windowName, int windowWidth, int windowHeight): FigureBase(windowName, windowWidth, windowHeight), m_X(0), m_Y(0){
-    m_Window = glfwCreateWindow(windowWidth, windowHeight, windowName.c_str(), NULL, NULL);
+  Figure::Figure(const std::string& windowName, int windowWidth, int windowHeight, GLFWwindow* sharedWindow): FigureBase(windowName, windowWidth, windowHeight), m_X(0), m_Y(0){
+    m_Window = glfwCreateWindow(windowWidth, windowHeight, windowName.c_str(), NULL, sharedWindow);
     if (!m_Window) {
       std::cout << "Window error" << std::endl;
       glfwTerminate();
@@ -41,13 +44,16 @@ namespace notlab{
 
   Figure::~Figure(){
     if(m_Window){
-      glfwDestroyWindow(m_Window);
-    }
-    if(m_Shader){
-      delete m_Shader;
-    }
-    if(m_Text){
+      glfwMakeContextCurrent(m_Window);
+      if(m_VAO != 0){
+        unsigned int arrays[] = {m_VAO, m_StreamVAO, m_MarkerVAO, m_LineVAO};
+        unsigned int buffers[] = {m_VBO, m_StreamVBO, m_MarkerVBO, m_LineVBO};
+        glDeleteVertexArrays(4, arrays);
+        glDeleteBuffers(4, buffers);
+      }
+      // Text deletes its vertex array, which belongs to this context.
       delete m_Text;
+      glfwDestroyWindow(m_Window);
     }
   }
 
@@ -91,23 +97,41 @@ namespace notlab{
     }
   }
 
-  void Figure::prepareData(VectorF &x, VectorF &y){
-    if(x.getSize() != y.getSize()){
+  void Figure::createBuffers(){
+    if(m_VAO != 0){
       return;
     }
-    glfwMakeContextCurrent(m_Window);
-    m_Shader = new Shader("../renderer/resources/vertex.glsl", "../renderer/resources/fragment.glsl");
-    m_Shader->compile();
+    m_Shader = ResourceCache::instance().getShader("../renderer/resources/vertex.glsl", "../renderer/resources/fragment.glsl");
+
+    // Both plot buffers hold samples relative to m_Origin, m_Model maps them to world.
+    unsigned int arrays[4], buffers[4];
+    glGenVertexArrays(4, arrays);
+    glGenBuffers(4, buffers);
+    m_VAO = arrays[0];
+    m_StreamVAO = arrays[1];
+    m_MarkerVAO = arrays[2];
+    m_LineVAO = arrays[3];
+    m_VBO = buffers[0];
+    m_StreamVBO = buffers[1];
+    m_MarkerVBO = buffers[2];
+    m_LineVBO = buffers[3];
+
+    for(int i = 0; i < 4; i++){
+      glBindVertexArray(arrays[i]);
+      glBindBuffer(GL_ARRAY_BUFFER, buffers[i]);
+      glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 2*sizeof(float), (void*)0);
+      glEnableVertexAttribArray(0);
+    }
 
-    m_X = x;
-    m_Y = y;
+    glBindBuffer(GL_ARRAY_BUFFER, m_MarkerVBO);
+    glBufferData(GL_ARRAY_BUFFER, 2 * sizeof(float), nullptr, GL_DYNAMIC_DRAW);
 
-    float xmin = x.min();
-    float xmax = x.max();
-    float ymin = y.min();
-    float ymax = y.max();
-    m_NumberOfPoints = x.getSize();
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
 
+    glBindVertexArray(0);
+  }
+
+  void Figure::prepareLayout(){
     int fbw, fbh;
     glfwGetFramebufferSize(m_Window, &fbw, &fbh);
 
@@ -122,32 +146,165 @@ namespace notlab{
     m_PlotBounds.w = plotW;
     m_PlotBounds.h = plotH;
 
-    std::vector<float> vbo; 
-    vbo.reserve(m_NumberOfPoints * 2);
+    Rect2D rect{plotX0, plotY0, plotW,plotH};
+    prepareAxis(rect, m_Xmin, m_Xmax, m_Ymin, m_Ymax);
+  }
 
-    for (size_t i = 1; i <= m_NumberOfPoints; ++i) {
-        float sx = plotX0 + (x(i) - xmin) / (xmax - xmin) * plotW;
-        float sy = plotY0 + (y(i) - ymin) / (ymax - ymin) * plotH;
-        vbo.push_back(sx);
-        vbo.push_back(sy);
+  void Figure::prepareData(VectorF &x, VectorF &y){
+    if(x.getSize() != y.getSize()){
+      return;
     }
-    glGenVertexArrays(1, &m_VAO);
-    glGenBuffers(1, &m_VBO);
+    glfwMakeContextCurrent(m_Window);
+    createBuffers();
 
-    glBindVertexArray(m_VAO);
+    m_X = x;
+    m_Y = y;
 
-    glBindBuffer(GL_ARRAY_BUFFER, m_VBO);
-    glBufferData(GL_ARRAY_BUFFER, vbo.size() * sizeof(float), vbo.data(), GL_DYNAMIC_DRAW);
+    m_Xmin = x.min();
+    m_Xmax = x.max();
+    m_Ymin = y.min();
+    m_Ymax = y.max();
+    m_NumberOfPoints = x.getSize();
+    m_IsSorted = std::is_sorted(x.getRawData(), x.getRawData() + m_NumberOfPoints);
+    m_Origin = m_NumberOfPoints > 0 ? glm::vec2(x.getRawData()[0], y.getRawData()[0]) : glm::vec2(0.0f, 0.0f);
+    m_Pyramid.build(m_Y.getRawData(), m_NumberOfPoints);
+    {
+      // Samples queued for previous data set don't belong to this one.
+      std::lock_guard<std::mutex> lock(m_PendingMutex);
+      m_PendingX.clear();
+      m_PendingY.clear();
+      m_HasLastX = m_NumberOfPoints > 0;
+      m_LastX = m_HasLastX ? m_Xmax : 0.0f;
+      // Ring is allocated below, so capacity set before is applied right away.
+      if(m_PendingStreamCapacity != 0){
+        m_MaxStreamCapacity = m_PendingStreamCapacity;
+        m_PendingStreamCapacity = 0;
+      }
+    }
 
-    glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 2*sizeof(float), (void*)0);
-    glEnableVertexAttribArray(0);
+    m_DecimatedWidth = 0;
+    m_StreamCapacity = 0;
+    reserveStream(m_NumberOfPoints);
 
-    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    prepareLayout();
+  }
 
-    glBindVertexArray(0);
+  void Figure::appendData(const float* x, const float* y, size_t count){
+    if(count == 0){
+      return;
+    }
+    std::lock_guard<std::mutex> lock(m_PendingMutex);
+    if(!std::is_sorted(x, x + count) || (m_HasLastX && x[0] < m_LastX)){
+      std::cout << "Error: x of appended samples must not decrease" << std::endl;
+      return;
+    }
+    m_LastX = x[count - 1];
+    m_HasLastX = true;
+    m_PendingX.insert(m_PendingX.end(), x, x + count);
+    m_PendingY.insert(m_PendingY.end(), y, y + count);
+  }
 
-    Rect2D rect{plotX0, plotY0, plotW,plotH};
-    prepareAxis(rect, xmin, xmax, ymin, ymax);
+  void Figure::setStreamCapacity(size_t numberOfSamples){
+    std::lock_guard<std::mutex> lock(m_PendingMutex);
+    m_PendingStreamCapacity = std::max<size_t>(numberOfSamples, 1);
+  }
+
+  void Figure::consumePendingSamples(){
+    std::vector<float> x, y;
+    size_t streamCapacity;
+    {
+      std::lock_guard<std::mutex> lock(m_PendingMutex);
+      x.swap(m_PendingX);
+      y.swap(m_PendingY);
+      streamCapacity = m_PendingStreamCapacity;
+      m_PendingStreamCapacity = 0;
+    }
+    if(streamCapacity != 0){
+      m_MaxStreamCapacity = streamCapacity;
+      if(m_StreamCapacity > m_MaxStreamCapacity){
+        // Ring is reallocated smaller below.
+        m_StreamCapacity = 0;
+      }
+    }
+    size_t previous = m_NumberOfPoints;
+    if(!x.empty()){
+      createBuffers();
+      if(previous == 0){
+        m_Origin = {x[0], y[0]};
+        m_Xmin = m_Xmax = x[0];
+        m_Ymin = m_Ymax = y[0];
+      }
+      for(size_t i = 0; i < x.size(); i++){
+        m_X.addBack(x[i]);
+        m_Y.addBack(y[i]);
+        m_Ymin = std::min(m_Ymin, y[i]);
+        m_Ymax = std::max(m_Ymax, y[i]);
+      }
+      // x is ascending.
+      m_Xmax = x.back();
+      m_NumberOfPoints = m_X.getSize();
+      m_Pyramid.extend(m_Y.getRawData(), m_NumberOfPoints);
+      if(previous == 0){
+        prepareLayout();
+      }
+    }
+
+    size_t numberOfPoints = m_NumberOfPoints;
+    if(std::min(numberOfPoints, m_MaxStreamCapacity) > m_StreamCapacity){
+      reserveStream(numberOfPoints);
+      return;
+    }
+    if(numberOfPoints > previous){
+      uploadStream(std::max(previous, numberOfPoints - std::min(numberOfPoints, m_StreamCapacity)), numberOfPoints);
+    }
+  }
+
+  void Figure::reserveStream(size_t numberOfSamples){
+    size_t capacity = std::min(m_MaxStreamCapacity, std::max(numberOfSamples, s_MinStreamCapacity));
+    if(m_StreamCapacity != 0){
+      // Doubling, so growing stream reallocates only log times.
+      capacity = std::min(m_MaxStreamCapacity, std::max(capacity, 2 * m_StreamCapacity));
+    }
+    m_StreamCapacity = capacity;
+    // Visible samples may no longer be in ring.
+    m_DecimatedWidth = 0;
+    glBindBuffer(GL_ARRAY_BUFFER, m_StreamVBO);
+    glBufferData(GL_ARRAY_BUFFER, (capacity + 1) * 2 * sizeof(float), nullptr, GL_DYNAMIC_DRAW);
+    size_t numberOfPoints = m_NumberOfPoints;
+    uploadStream(numberOfPoints - std::min(numberOfPoints, capacity), numberOfPoints);
+  }
+
+  void Figure::uploadStream(size_t from, size_t to){
+    glBindBuffer(GL_ARRAY_BUFFER, m_StreamVBO);
+    while(from < to){
+      size_t slot = from % m_StreamCapacity;
+      size_t count = std::min(to - from, m_StreamCapacity - slot);
+      m_StreamVertices.clear();
+      for(size_t i = from; i < from + count; i++){
+        m_StreamVertices.push_back(m_X.getRawData()[i] - m_Origin.x);
+        m_StreamVertices.push_back(m_Y.getRawData()[i] - m_Origin.y);
+      }
+      glBufferSubData(GL_ARRAY_BUFFER, slot * 2 * sizeof(float), m_StreamVertices.size() * sizeof(float), m_StreamVertices.data());
+      if(slot == 0){
+        glBufferSubData(GL_ARRAY_BUFFER, m_StreamCapacity * 2 * sizeof(float), 2 * sizeof(float), m_StreamVertices.data());
+      }
+      from += count;
+    }
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+  }
+
+  void Figure::drawStream(GLenum mode){
+    glBindVertexArray(m_StreamVAO);
+    size_t slot = m_StreamFirst % m_StreamCapacity;
+    size_t count = m_StreamLast - m_StreamFirst;
+    if(slot + count <= m_StreamCapacity){
+      glDrawArrays(mode, (GLint)slot, (GLsizei)count);
+      return;
+    }
+    // Up to repeated slot 0 at the end, then rest from the beginning.
+    size_t head = m_StreamCapacity + 1 - slot;
+    glDrawArrays(mode, (GLint)slot, (GLsizei)head);
+    glDrawArrays(mode, 0, (GLsizei)(count - head + 1));
   }
 
   Line computeYAxis(const Rect2D& rect, float xmin, float xmax){
@@ -198,20 +355,9 @@ namespace notlab{
     };
 
 
-    glGenVertexArrays(1, &m_LineVAO);
-    glGenBuffers(1, &m_LineVBO);
-
-    glBindVertexArray(m_LineVAO);
-
     glBindBuffer(GL_ARRAY_BUFFER, m_LineVBO);
     glBufferData(GL_ARRAY_BUFFER, sizeof(axisData), axisData, GL_DYNAMIC_DRAW);
-
-    glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 2*sizeof(float), (void*)0);
-    glEnableVertexAttribArray(0);
-
     glBindBuffer(GL_ARRAY_BUFFER, 0);
-
-    glBindVertexArray(0);
   }
 
   glm::vec2 mouseScreenToWolrd(double mouseX, double mouseY, int fbw, int fbh, const glm::mat4& view){
@@ -223,6 +369,11 @@ namespace notlab{
     return glm::vec2(p.x, p.y);
   }
 
+  // Width of data range, a single sample or constant series gets unit width.
+  static float span(float min, float max){
+    return max > min ? max - min : 1.0f;
+  }
+
   float clamp(float x, float min, float max){
     if(x < min){
       return min;
@@ -245,31 +396,31 @@ namespace notlab{
 
   float Figure::worldXtoDataX(float worldX) const{
     float t = (worldX - m_PlotBounds.x) / m_PlotBounds.w;
-    float xmin = m_X.min(); 
-    float xmax = m_X.max();
-    float x = xmin + t * (xmax - xmin);
+    float xmin = m_Xmin;
+    float xmax = m_Xmax;
+    float x = xmin + t * span(xmin, xmax);
     return x;
   }
 
   float Figure::worldYtoDataY(float worldY) const{
     float t = (worldY - m_PlotBounds.y) / m_PlotBounds.h;
-    float ymin = m_Y.min(); 
-    float ymax = m_Y.max();
-    float y = ymin + t * (ymax - ymin);
+    float ymin = m_Ymin;
+    float ymax = m_Ymax;
+    float y = ymin + t * span(ymin, ymax);
     return y;
   }
 
   float Figure::dataXtoWorldX(float dataX) const{
-    float xmin = m_X.min(); 
-    float xmax = m_X.max();
-    return m_PlotBounds.x + (dataX - xmin) * m_PlotBounds.w / (xmax - xmin);
+    float xmin = m_Xmin;
+    float xmax = m_Xmax;
+    return m_PlotBounds.x + (dataX - xmin) * m_PlotBounds.w / span(xmin, xmax);
   }
 
   float Figure::dataYtoWorldY(float dataY) const
   {
-    float ymin = m_Y.min(); 
-    float ymax = m_Y.max();
-    return m_PlotBounds.y + (dataY - ymin) * m_PlotBounds.h / (ymax - ymin);
+    float ymin = m_Ymin;
+    float ymax = m_Ymax;
+    return m_PlotBounds.y + (dataY - ymin) * m_PlotBounds.h / span(ymin, ymax);
   }
 
 
@@ -290,7 +441,12 @@ namespace notlab{
 
   void Figure::calculateMatrixes(){
     m_Shader->bind();
-    m_Model = glm::mat4(1.0f);
+    // Plot buffers hold samples minus m_Origin, so growing data range only changes this matrix.
+    float scaleX = m_PlotBounds.w / span(m_Xmin, m_Xmax);
+    float scaleY = m_PlotBounds.h / span(m_Ymin, m_Ymax);
+    m_Model = glm::translate(glm::mat4(1.0f), glm::vec3(m_PlotBounds.x + (m_Origin.x - m_Xmin) * scaleX,
+                                                        m_PlotBounds.y + (m_Origin.y - m_Ymin) * scaleY, 0.0f));
+    m_Model = glm::scale(m_Model, glm::vec3(scaleX, scaleY, 1.0f));
 
     m_View = glm::translate(glm::mat4(1.0f), glm::vec3(m_Camera.pan, 0.0f));
 
@@ -306,28 +462,107 @@ namespace notlab{
     m_Shader->setMat4("uProjection", m_Projection);
   }
 
+  void Figure::updateLevelOfDetail(){
+    // Unsorted series is uploaded whole, view doesn't change what is uploaded.
+    if(m_NumberOfPoints == 0 || ((!m_IsSorted || m_View == m_DecimatedView) && m_Fbw == m_DecimatedWidth && m_NumberOfPoints == m_DecimatedPoints)){
+      return;
+    }
+    m_DecimatedView = m_View;
+    m_DecimatedWidth = m_Fbw;
+    m_DecimatedPoints = m_NumberOfPoints;
+
+    // Data range between left and right edge of window, one bucket per pixel column.
+    glm::mat4 inverseView = glm::inverse(m_View);
+    float worldLeft = (inverseView * glm::vec4(0.0f, 0.0f, 0.0f, 1.0f)).x;
+    float worldRight = (inverseView * glm::vec4((float)m_Fbw, 0.0f, 0.0f, 1.0f)).x;
+    float dataLeft = worldXtoDataX(worldLeft);
+    float dataRight = worldXtoDataX(worldRight);
+
+    size_t numberOfPoints = m_NumberOfPoints;
+    if(m_IsSorted){
+      // Live view of few newest samples is drawn straight from the ring, nothing to upload.
+      // More than decimation would keep go through pyramid, like any other view.
+      size_t first, last;
+      detail::visibleRange(m_X.getRawData(), numberOfPoints, dataLeft, dataRight, first, last);
+      m_DrawStream = first >= numberOfPoints - std::min(numberOfPoints, m_StreamCapacity)
+                     && last - first <= 4 * (size_t)m_Fbw;
+      if(m_DrawStream){
+        m_StreamFirst = first;
+        m_StreamLast = last;
+        m_IsDecimated = false;
+        return;
+      }
+
+      m_IsDecimated = m_Pyramid.decimate(m_X.getRawData(), m_Y.getRawData(), numberOfPoints,
+                                         dataLeft, dataRight, m_Fbw, m_VisibleIndices);
+    }
+    else{
+      // Visible range and buckets need ascending x, series is drawn in given order instead.
+      m_DrawStream = false;
+      m_IsDecimated = false;
+      m_VisibleIndices.resize(numberOfPoints);
+      std::iota(m_VisibleIndices.begin(), m_VisibleIndices.end(), size_t(0));
+    }
+
+    m_VisibleVertices.clear();
+    for(size_t i : m_VisibleIndices){
+      m_VisibleVertices.push_back(m_X.getRawData()[i] - m_Origin.x);
+      m_VisibleVertices.push_back(m_Y.getRawData()[i] - m_Origin.y);
+    }
+    m_NumberOfVisibleVertices = (int)m_VisibleIndices.size();
+
+    glBindBuffer(GL_ARRAY_BUFFER, m_VBO);
+    if(m_VisibleIndices.size() > m_VertexCapacity){
+      // Enough for any view of this window width, so panning doesn't reallocate.
+      m_VertexCapacity = std::max(m_VisibleIndices.size(), 4 * (size_t)m_Fbw + 2);
+      glBufferData(GL_ARRAY_BUFFER, m_VertexCapacity * 2 * sizeof(float), nullptr, GL_DYNAMIC_DRAW);
+    }
+    glBufferSubData(GL_ARRAY_BUFFER, 0, m_VisibleVertices.size() * sizeof(float), m_VisibleVertices.data());
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+  }
+
   void Figure::renderPlot(){
     m_Shader->setVec3("uColor", glm::vec3(0.4f, 0.5f, 0.6f));
+    if(m_DrawStream){
+      drawStream(GL_LINE_STRIP);
+      if(!m_IsDecimated){
+        glPointSize(6.0f);
+        drawStream(GL_POINTS);
+      }
+      return;
+    }
     glBindVertexArray(m_VAO);
-    glDrawArrays(GL_LINE_STRIP, 0, m_NumberOfPoints);
-    glPointSize(6.0f);
-    glDrawArrays(GL_POINTS, 0, m_NumberOfPoints);
+    glDrawArrays(GL_LINE_STRIP, 0, m_NumberOfVisibleVertices);
+    // Points of decimated plot would cover it as a solid band.
+    if(!m_IsDecimated){
+      glPointSize(6.0f);
+      glDrawArrays(GL_POINTS, 0, m_NumberOfVisibleVertices);
+    }
   }
 
   void Figure::renderAxis(){
     m_Shader->bind();
+    m_Shader->setMat4("uModel", glm::mat4(1.0f));
     m_Shader->setVec3("uColor", glm::vec3(0.9f, 0.9f, 0.9f));
     glBindVertexArray(m_LineVAO);
     glDrawArrays(GL_LINES, 0, 4);
   }
 
   void Figure::renderScene(){
+    consumePendingSamples();
+    if(m_NumberOfPoints == 0){
+      return;
+    }
     calculateMatrixes();
+    updateLevelOfDetail();
     renderPlot();  
     renderAxis();
   }
 
   void Figure::renderUI(){
+    if(m_NumberOfPoints == 0){
+      return;
+    }
     double xpos, ypos;
     glfwGetCursorPos(m_Window, &xpos, &ypos);
 
@@ -382,12 +617,20 @@ namespace notlab{
     }
 
 
+    float marker[2] = {functionWorldX, functionWorldY};
+    glBindBuffer(GL_ARRAY_BUFFER, m_MarkerVBO);
+    glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(marker), marker);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
     m_Shader->bind();
+    m_Shader->setMat4("uModel", glm::mat4(1.0f));
     m_Shader->setVec3("uColor", glm::vec3(1.0f, 0.0f, 0.0f));
-    glBindVertexArray(m_VAO);
+    glBindVertexArray(m_MarkerVAO);
 
     glPointSize(10.0f);
-    glDrawArrays(GL_POINTS, (GLint)closestData, 1);
+    glDrawArrays(GL_POINTS, 0, 1);
+
+    m_Text->flush();
   }
 
   // void Figure::plot(){
@@ -1,12 +1,15 @@
 #pragma once
 
+#include <mutex>
 #include <string>
+#include <vector>
 
 #include <GL/glew.h>
 #include <GLFW/glfw3.h>
 
 #include "Shader.h"
 #include "text.h"
+#include "decimation.h"
 #include "../core/vector.h"
 
 #include "figure_base.h"
@@ -41,21 +44,80 @@ namespace notlab{
             Line m_AxisX;
             Line m_AxisY;
 
-            int m_NumberOfPoints;
+            int m_NumberOfPoints = 0;
+
+            /// Range of data, cached so mapping between data and world doesn't scan it. Grows with appended samples.
+            float m_Xmin = 0.0f;
+            float m_Xmax = 1.0f;
+            float m_Ymin = 0.0f;
+            float m_Ymax = 1.0f;
+            /// Plot vertex buffers hold samples relative to first sample, m_Model maps them to world.
+            glm::vec2 m_Origin{0.0f, 0.0f};
 
             glm::mat4 m_Model{1.0f};
             glm::mat4 m_View{1.0f};
             glm::mat4 m_Projection{1.0f};
 
-            unsigned int m_VAO;
-            unsigned int m_VBO;
-
-            unsigned int m_LineVAO;
-            unsigned int m_LineVBO;
+            /// Holds only decimated visible part of plot, see updateLevelOfDetail.
+            /// Whole series when x isn't ascending.
+            unsigned int m_VAO = 0;
+            unsigned int m_VBO = 0;
+            size_t m_VertexCapacity = 0;
+            int m_NumberOfVisibleVertices = 0;
+            bool m_IsDecimated = false;
+            std::vector<size_t> m_VisibleIndices;
+            std::vector<float> m_VisibleVertices;
+            /// Built once per data set and extended by appended samples, so decimating any view costs O(columns * log n).
+            SeriesPyramid m_Pyramid;
+            /// View, framebuffer width and number of samples m_VBO was built for.
+            glm::mat4 m_DecimatedView{0.0f};
+            int m_DecimatedWidth = 0;
+            int m_DecimatedPoints = 0;
+            /// x of series given to prepareData is ascending, needed for decimation and ring.
+            bool m_IsSorted = true;
+
+            /// Ring of newest samples, sample i is in slot i % m_StreamCapacity and is uploaded once.
+            /// Slot m_StreamCapacity repeats slot 0, so line strip stays connected where ring wraps.
+            unsigned int m_StreamVAO = 0;
+            unsigned int m_StreamVBO = 0;
+            size_t m_StreamCapacity = 0;
+            size_t m_MaxStreamCapacity = s_DefaultMaxStreamCapacity;
+            std::vector<float> m_StreamVertices;
+            /// Visible samples [m_StreamFirst, m_StreamLast) are all in ring and no more than 4 per pixel column, drawn from it undecimated.
+            bool m_DrawStream = false;
+            size_t m_StreamFirst = 0;
+            size_t m_StreamLast = 0;
+
+            static constexpr size_t s_DefaultMaxStreamCapacity = 1 << 20;
+            static constexpr size_t s_MinStreamCapacity = 4096;
+
+            /// Samples given to appendData, moved into m_X and m_Y on next frame.
+            std::mutex m_PendingMutex;
+            std::vector<float> m_PendingX;
+            std::vector<float> m_PendingY;
+            /// Largest x given so far, appended x must not be smaller.
+            float m_LastX = 0.0f;
+            bool m_HasLastX = false;
+            /// Capacity given to setStreamCapacity, applied on next frame, 0 if none.
+            size_t m_PendingStreamCapacity = 0;
+
+            /// Highlighted sample closest to cursor.
+            unsigned int m_MarkerVAO = 0;
+            unsigned int m_MarkerVBO = 0;
+
+            unsigned int m_LineVAO = 0;
+            unsigned int m_LineVBO = 0;
 
             Figure(int id);
+            void createBuffers();
+            void prepareLayout();
             void prepareAxis(const Rect2D& rect, float xmin, float xmax, float ymin, float ymax);
 
+            void consumePendingSamples();
+            void reserveStream(size_t numberOfSamples);
+            void uploadStream(size_t from, size_t to);
+            void drawStream(GLenum mode);
+
             float worldXtoDataX(float worldX) const;
             float worldYtoDataY(float worldY) const;
 
@@ -72,6 +134,7 @@ namespace notlab{
 
 
             void calculateMatrixes();
+            void updateLevelOfDetail();
             void renderPlot();
             void renderAxis();
 
@@ -85,12 +148,37 @@ namespace notlab{
         public:
             void prepareData(VectorF &x, VectorF &y);
 
+            /**
+             * @brief Queues samples to be added to the end of plotted series.
+             * @details
+             *   Safe to call from another thread while Renderer::render runs,
+             *   samples show up on next frame. Only new samples are uploaded
+             *   to GPU and data range is updated from them alone.
+             *
+             * @param x x of samples, ascending and not smaller than x of samples given before.
+             * @param y y of samples.
+             * @param count Number of samples.
+             */
+            void appendData(const float* x, const float* y, size_t count);
+
+            /**
+             * @brief Set how many newest samples are kept on GPU for drawing without decimation, default 2^20.
+             * @details
+             *   Views reaching older samples or more than 4 samples per pixel column are drawn decimated from whole series.
+             *   Safe to call from another thread while Renderer::render runs, applied on next frame.
+             */
+            void setStreamCapacity(size_t numberOfSamples);
+
             void setTitle(const std::string& title) { m_Title = title; }
             void setLabelX(const std::string& labelX) { m_LabelX = labelX; }
             void setLabelY(const std::string& labelY) { m_LabelY = labelY; }
 
             
-            Figure(const std::string& windowName, int windowWidth, int windowHeight);
+            /**
+             * @brief Opens figure window.
+             * @param sharedWindow Window whose context shares objects with the new one, so cached shaders and fonts are reused.
+             */
+            Figure(const std::string& windowName, int windowWidth, int windowHeight, GLFWwindow* sharedWindow = nullptr);
             ~Figure() override;
             
             GLFWwindow* getWindow(){
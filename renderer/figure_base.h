@@ -15,6 +15,7 @@ namespace notlab{
     class FigureBase{
         protected:
             GLFWwindow* m_Window = nullptr;
+            /// Owned by ResourceCache.
             Shader* m_Shader = nullptr;
             Text* m_Text = nullptr;
 
@@ -1,4 +1,5 @@
 #include "renderer.h"
+#include "resource_cache.h"
 #include <iostream>
 
 namespace notlab{
@@ -57,7 +58,7 @@ namespace notlab{
         if(m_Status != Status::Initialized && m_Status != Status::Ready){
             return -1;
         }
-        m_Figures.emplace_back(std::make_unique<Figure>(windowName, windowWidth, windowHeight));
+        m_Figures.emplace_back(std::make_unique<Figure>(windowName, windowWidth, windowHeight, m_mainWindow));
         Figure &fig = *m_Figures.back();
         m_Status = Status::Ready;
         return fig.m_Id;
@@ -76,6 +77,31 @@ namespace notlab{
         //figure.plot();
     }
 
+    void Renderer::appendData(int figureId, const VectorF& x, const VectorF& y){
+        if(m_Status != Status::Ready){
+            return;
+        }
+        if(x.getSize() != y.getSize()){
+            std::cout << "Error: x and y of appended samples have different sizes" << std::endl;
+            return;
+        }
+        std::lock_guard<std::mutex> lock(m_FiguresMutex);
+        Figure& figure = findFigure(figureId);
+        if(&figure == m_ErrorFigure){
+            return;
+        }
+        figure.appendData(x.getRawData(), y.getRawData(), x.getSize());
+    }
+
+    void Renderer::setStreamCapacity(int figureId, size_t numberOfSamples){
+        std::lock_guard<std::mutex> lock(m_FiguresMutex);
+        Figure& fig = findFigure(figureId);
+        if(&fig == m_ErrorFigure){
+            return;
+        }
+        fig.setStreamCapacity(numberOfSamples);
+    }
+
     void Renderer::setLabelX(int fiugreId, const std::string& labelX){
         Figure& fig = findFigure(fiugreId);
         if(&fig == m_ErrorFigure){
@@ -113,6 +139,7 @@ namespace notlab{
                 glfwMakeContextCurrent(win);
                 
                 if(glfwWindowShouldClose(win)){
+                    std::lock_guard<std::mutex> lock(m_FiguresMutex);
                     figure = m_Figures.erase(figure);
                     std::cout << "Zostało: " << m_Figures.size() << "okien" << std::endl;
                     continue;
@@ -130,8 +157,14 @@ namespace notlab{
                 m_isRunning = false;
             }
         }
-        m_Figures.clear();
+        {
+            std::lock_guard<std::mutex> lock(m_FiguresMutex);
+            m_Figures.clear();
+        }
         delete m_ErrorFigure;
+        // Cached programs and textures live in share group of hidden window.
+        glfwMakeContextCurrent(m_mainWindow);
+        ResourceCache::instance().clear();
         glfwMakeContextCurrent(nullptr);
         glfwTerminate();
     }
@@ -7,6 +7,7 @@
 #include <vector>
 
 #include <memory>
+#include <mutex>
 
 #include <../core/vector.h>
 
@@ -24,6 +25,8 @@ namespace notlab{
             
             bool m_isRunning = false;
             std::vector<std::unique_ptr<Figure>> m_Figures;
+            /// Guards m_Figures against closing windows while appendData runs on another thread.
+            std::mutex m_FiguresMutex;
             Figure* m_ErrorFigure;
 
             Figure& findFigure(int figureId);
@@ -42,6 +45,16 @@ namespace notlab{
             void render();
             int addFigure(const std::string& windowName="figure", int windowWidth = 640, int windowHeight = 480);
             void testPlot(int figureId, VectorF& x, VectorF& y);
+            /**
+             * @brief Add samples to the end of figure's series, see Figure::appendData.
+             * @details Safe to call from another thread while render runs, so live data can be plotted.
+             */
+            void appendData(int figureId, const VectorF& x, const VectorF& y);
+            /**
+             * @brief Set how many newest samples of figure are kept on GPU, see Figure::setStreamCapacity.
+             * @details Safe to call from another thread while render runs.
+             */
+            void setStreamCapacity(int figureId, size_t numberOfSamples);
             void setLabelX(int fiugreId, const std::string& labelX);
             void setLabelY(int fiugreId, const std::string& labelY);
             void setTitle(int fiugreId, const std::string& title);
@@ -0,0 +1,115 @@
+#include "resource_cache.h"
+
+#include <ft2build.h>
+#include FT_FREETYPE_H
+
+#include <algorithm>
+#include <iostream>
+#include <vector>
+
+namespace notlab{
+
+    Shader* ResourceCache::getShader(const std::string& vertexPath, const std::string& fragmentPath){
+        std::unique_ptr<Shader>& shader = m_Shaders[{vertexPath, fragmentPath}];
+        if(!shader){
+            shader = std::make_unique<Shader>(vertexPath, fragmentPath);
+            shader->compile();
+        }
+        return shader.get();
+    }
+
+    const Font* ResourceCache::getFont(const std::string& fontPath, int pixelHeight){
+        auto fontIterator = m_Fonts.find({fontPath, pixelHeight});
+        if(fontIterator != m_Fonts.end()){
+            return fontIterator->second.get();
+        }
+
+        FT_Library ft;
+        if(FT_Init_FreeType(&ft)){
+            std::cout << "Error: Freetype Init failed" << std::endl;
+            return nullptr;
+        }
+
+        FT_Face face;
+
+        if(FT_New_Face(ft, fontPath.c_str(), 0, &face)){
+            std::cout << "Error: Freetype new Face failed" << std::endl;
+            FT_Done_FreeType(ft);
+            return nullptr;
+        }
+
+        FT_Set_Pixel_Sizes(face, 0, pixelHeight);
+
+        // Glyphs are placed left to right in rows as tall as their tallest glyph, 1 pixel apart.
+        auto font = std::make_unique<Font>();
+        std::vector<std::vector<unsigned char>> bitmaps(font->glyphs.size());
+        std::vector<glm::ivec2> positions(font->glyphs.size());
+        int atlasWidth = 1024;
+        int rowX = 1, rowY = 1, rowHeight = 0;
+        for(unsigned char c = 32; c < 128; c++){
+            if(FT_Load_Char(face, c, FT_LOAD_RENDER)){
+                continue;
+            }
+            const FT_Bitmap& bitmap = face->glyph->bitmap;
+
+            Glyph& glyph = font->glyphs[c];
+            glyph.size = { (int)bitmap.width, (int)bitmap.rows};
+            glyph.bearing = { face->glyph->bitmap_left, face->glyph->bitmap_top};
+            glyph.advance = (unsigned int) face->glyph->advance.x;
+
+            // Rows of FreeType bitmap may be padded to pitch.
+            for(unsigned int row = 0; row < bitmap.rows; row++){
+                const unsigned char* rowData = bitmap.buffer + row * bitmap.pitch;
+                bitmaps[c].insert(bitmaps[c].end(), rowData, rowData + bitmap.width);
+            }
+            atlasWidth = std::max(atlasWidth, glyph.size.x + 2);
+            if(rowX + glyph.size.x + 1 > atlasWidth){
+                rowX = 1;
+                rowY += rowHeight + 1;
+                rowHeight = 0;
+            }
+            positions[c] = {rowX, rowY};
+            rowX += glyph.size.x + 1;
+            rowHeight = std::max(rowHeight, glyph.size.y);
+        }
+        int atlasHeight = rowY + rowHeight + 1;
+
+        std::vector<unsigned char> atlas((size_t)atlasWidth * atlasHeight, 0);
+        for(size_t c = 0; c < font->glyphs.size(); c++){
+            Glyph& glyph = font->glyphs[c];
+            for(int row = 0; row < glyph.size.y; row++){
+                std::copy_n(bitmaps[c].data() + (size_t)row * glyph.size.x, glyph.size.x,
+                            atlas.data() + (size_t)(positions[c].y + row) * atlasWidth + positions[c].x);
+            }
+            glyph.uvMin = { (float)positions[c].x / atlasWidth, (float)positions[c].y / atlasHeight};
+            glyph.uvMax = { (float)(positions[c].x + glyph.size.x) / atlasWidth, (float)(positions[c].y + glyph.size.y) / atlasHeight};
+        }
+
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+        glGenTextures(1, &font->atlas);
+        glBindTexture(GL_TEXTURE_2D, font->atlas);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RED, atlasWidth, atlasHeight, 0, GL_RED, GL_UNSIGNED_BYTE, atlas.data());
+
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glBindTexture(GL_TEXTURE_2D, 0);
+
+        FT_Done_Face(face);
+        FT_Done_FreeType(ft);
+
+        const Font* loaded = font.get();
+        m_Fonts.emplace(std::make_pair(fontPath, pixelHeight), std::move(font));
+        return loaded;
+    }
+
+    void ResourceCache::clear(){
+        for(auto& font : m_Fonts){
+            glDeleteTextures(1, &font.second->atlas);
+        }
+        m_Fonts.clear();
+        m_Shaders.clear();
+    }
+
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <map>
+#include <memory>
+#include <string>
+#include <utility>
+
+#include "Shader.h"
+#include "text.h"
+
+namespace notlab{
+
+    /**
+     * @class ResourceCache
+     * @brief Shader programs and fonts shared by all figures.
+     * @details
+     *   Figure windows share objects with hidden main window of Renderer,
+     *   so a program or glyph texture created in one figure's context is
+     *   usable in all of them. Each pair of shader files is compiled and
+     *   each font rasterized once per process, figures after the first only
+     *   look them up. Vertex arrays aren't shared between contexts, so
+     *   figures and texts still create their own.
+     */
+    class ResourceCache{
+        private:
+            std::map<std::pair<std::string, std::string>, std::unique_ptr<Shader>> m_Shaders;
+            std::map<std::pair<std::string, int>, std::unique_ptr<Font>> m_Fonts;
+
+            ResourceCache() = default;
+
+        public:
+            ResourceCache(const ResourceCache&) = delete;
+            ResourceCache& operator=(const ResourceCache&) = delete;
+
+            static ResourceCache& instance(){
+                static ResourceCache inst;
+                return inst;
+            }
+
+            /**
+             * @brief Program made of vertex and fragment shader files, compiled on first use.
+             * @details Owned by cache, valid until clear.
+             */
+            Shader* getShader(const std::string& vertexPath, const std::string& fragmentPath);
+
+            /**
+             * @brief Glyphs of printable ASCII characters packed into one texture, rasterized on first use.
+             * @details Owned by cache, valid until clear.
+             * @return const Font* nullptr if font can't be loaded.
+             */
+            const Font* getFont(const std::string& fontPath, int pixelHeight);
+
+            /**
+             * @brief Deletes all programs and glyph textures, context sharing them must be current.
+             */
+            void clear();
+    };
+
+}
@@ -1,11 +1,11 @@
 #version 330 core
 in vec2 vUV;
+in vec3 vColor;
 out vec4 FragColor;
 
 uniform sampler2D uText;
-uniform vec3 uColor;
 
 void main() {
     float a = texture(uText, vUV).r; // GL_RED
-    FragColor = vec4(uColor, a);
+    FragColor = vec4(vColor, a);
 }
@@ -1,12 +1,11 @@
 #version 330 core
-layout(location = 0) in vec4 aVertex; // x, y, u, v
+layout(location = 0) in vec4 aVertex; // x, y in clip space, u, v
+layout(location = 1) in vec3 aColor;
 out vec2 vUV;
-
-uniform mat4 uModel;
-uniform mat4 uProjection;
-uniform mat4 uView;
+out vec3 vColor;
 
 void main() {
-    gl_Position = uProjection * uView * uModel * vec4(aVertex.xy, 0.0, 1.0);
+    gl_Position = vec4(aVertex.xy, 0.0, 1.0);
     vUV = aVertex.zw;
+    vColor = aColor;
 }
\ No newline at end of file
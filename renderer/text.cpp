@@ -1,74 +1,33 @@
 #include "text.h"
+#include "resource_cache.h"
 
-#include <ft2build.h>
-#include FT_FREETYPE_H
-
-#include <iostream>
+#include <algorithm>
 
 namespace notlab{
 
     Text::~Text(){
-        if(m_Shader){
-            delete m_Shader;
+        if(m_VAO != 0){
+            glDeleteVertexArrays(1, &m_VAO);
+            glDeleteBuffers(1, &m_VBO);
         }
     }
 
     int Text::init(const std::string& fontPath, int pixelHeight){
-        m_Shader = new Shader("../renderer/resources/textVertex.glsl", "../renderer/resources/textFragment.glsl");
-        m_Shader->compile();
-
-        FT_Library ft;
-        if(FT_Init_FreeType(&ft)){
-            std::cout << "Error: Freetype Init failed" << std::endl;
+        m_Shader = ResourceCache::instance().getShader("../renderer/resources/textVertex.glsl", "../renderer/resources/textFragment.glsl");
+        m_Font = ResourceCache::instance().getFont(fontPath, pixelHeight);
+        if(!m_Font){
             return -1;
         }
 
-        FT_Face face;
-
-        if(FT_New_Face(ft, fontPath.c_str(), 0, &face)){
-            std::cout << "Error: Freetype new Face failed" << std::endl;
-            FT_Done_FreeType(ft);
-            return -2;
-        }
-
-        FT_Set_Pixel_Sizes(face, 0, pixelHeight);
-        glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
-
-        for(unsigned char c = 32; c < 128; c++){
-            if(FT_Load_Char(face, c, FT_LOAD_RENDER)){
-                continue;
-            }
-
-            unsigned int texture;
-            glGenTextures(1, &texture);
-            glBindTexture(GL_TEXTURE_2D, texture);
-            glTexImage2D(GL_TEXTURE_2D, 0, GL_RED, face->glyph->bitmap.width, face->glyph->bitmap.rows, 0, GL_RED, GL_UNSIGNED_BYTE, face->glyph->bitmap.buffer);
-
-            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
-            Glyph glyph;
-            glyph.texture = texture;
-            glyph.size = { (int)face->glyph->bitmap.width, (int)face->glyph->bitmap.rows};
-            glyph.bearing = { face->glyph->bitmap_left, face->glyph->bitmap_top};
-            glyph.advance = (unsigned int) face->glyph->advance.x;
-
-            m_Glyphs[c] = glyph;
-        }
-
-        FT_Done_Face(face);
-        FT_Done_FreeType(ft);
-
         glGenVertexArrays(1, &m_VAO);
         glGenBuffers(1, &m_VBO);
         glBindVertexArray(m_VAO);
         glBindBuffer(GL_ARRAY_BUFFER, m_VBO);
-        glBufferData(GL_ARRAY_BUFFER, sizeof(float) * 6 * 4, nullptr, GL_DYNAMIC_DRAW);
 
         glEnableVertexAttribArray(0);
-        glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, 4*sizeof(float), (void*)0);
+        glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, 7*sizeof(float), (void*)0);
+        glEnableVertexAttribArray(1);
+        glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 7*sizeof(float), (void*)(4*sizeof(float)));
 
         glBindBuffer(GL_ARRAY_BUFFER, 0);
         glBindVertexArray(0);
@@ -78,98 +37,69 @@ namespace notlab{
     
 
     void Text::drawScreen(const std::string& text, float x, float y, float scale, const glm::vec3& color, const glm::mat4& projection, const glm::mat4& model){
-        // glEnable(GL_BLEND);
-        // glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-
-        // m_Shader->bind();
-        // m_Shader->setMat4("uProjection", projection);
-        // m_Shader->setVec3("uColor", color);
-        // glActiveTexture(GL_TEXTURE0);
-
-        // glBindVertexArray(m_VAO);
-
-        // for(unsigned char c : text){
-        //     auto glyphIterator = m_Glyphs.find(c);
-        //     if(glyphIterator == m_Glyphs.end()){
-        //         std::cout << "Cant find char: " << c << std::endl;
-        //         continue;
-        //     }
-        //     const Glyph& glyph = glyphIterator->second;
-
-        //     float xpos = x + glyph.bearing.x * scale;
-        //     float ypos = y - (glyph.size.y - glyph.bearing.y) * scale;
-        //     float w = glyph.size.x * scale;
-        //     float h = glyph.size.y * scale;
-
-        //     float vertices[6][4] = {
-        //         { xpos,     ypos + h, 0.0f, 0.0f },
-        //         { xpos,     ypos,     0.0f, 1.0f },
-        //         { xpos + w, ypos,     1.0f, 1.0f },
-
-        //         { xpos,     ypos + h, 0.0f, 0.0f },
-        //         { xpos + w, ypos,     1.0f, 1.0f },
-        //         { xpos + w, ypos + h, 1.0f, 0.0f }
-        //     };
-        //     glBindTexture(GL_TEXTURE_2D, glyph.texture);
-        //     glBindBuffer(GL_ARRAY_BUFFER, m_VBO);
-        //     glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(vertices), vertices);
-
-        //     glDrawArrays(GL_TRIANGLES, 0, 6);
-
-        //     x += (glyph.advance >> 6) * scale;
-        // }
-
-        // glBindVertexArray(0);
-        // glBindTexture(GL_TEXTURE_2D, 0);
         drawWorld(text, x, y, scale, color, projection, glm::mat4(1.0f), model);
     }
 
     void Text::drawWorld(const std::string& text, float x, float y, float scale, const glm::vec3& color, const glm::mat4& projection, const glm::mat4& view, const glm::mat4& model){
-        glEnable(GL_BLEND);
-        glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-
-
-        m_Shader->bind();
-        m_Shader->setMat4("uModel", model);
-        m_Shader->setMat4("uProjection", projection);
-        m_Shader->setMat4("uView", view);
-        m_Shader->setVec3("uColor", color);
-        glActiveTexture(GL_TEXTURE0);
-
-        glBindVertexArray(m_VAO);
+        if(!m_Font){
+            return;
+        }
+        // Transformed here, so texts with different matrices and colors go into one draw call.
+        glm::mat4 transform = projection * view * model;
+        auto vertex = [&](float vx, float vy, float u, float v){
+            glm::vec4 position = transform * glm::vec4(vx, vy, 0.0f, 1.0f);
+            m_Vertices.insert(m_Vertices.end(), {position.x / position.w, position.y / position.w, u, v, color.x, color.y, color.z});
+        };
 
         for(unsigned char c : text){
-            auto glyphIterator = m_Glyphs.find(c);
-            if(glyphIterator == m_Glyphs.end()){
-                std::cout << "Cant find char: " << c << std::endl;
+            if(c >= m_Font->glyphs.size()){
                 continue;
             }
-            const Glyph& glyph = glyphIterator->second;
-
-            float xpos = x + glyph.bearing.x * scale;
-            float ypos = y - (glyph.size.y - glyph.bearing.y) * scale;
-            float w = glyph.size.x * scale;
-            float h = glyph.size.y * scale;
+            const Glyph& glyph = m_Font->glyphs[c];
 
-            float vertices[6][4] = {
-                { xpos,     ypos + h, 0.0f, 0.0f },
-                { xpos,     ypos,     0.0f, 1.0f },
-                { xpos + w, ypos,     1.0f, 1.0f },
+            if(glyph.size.x > 0 && glyph.size.y > 0){
+                float xpos = x + glyph.bearing.x * scale;
+                float ypos = y - (glyph.size.y - glyph.bearing.y) * scale;
+                float w = glyph.size.x * scale;
+                float h = glyph.size.y * scale;
 
-                { xpos,     ypos + h, 0.0f, 0.0f },
-                { xpos + w, ypos,     1.0f, 1.0f },
-                { xpos + w, ypos + h, 1.0f, 0.0f }
-            };
-            glBindTexture(GL_TEXTURE_2D, glyph.texture);
-            glBindBuffer(GL_ARRAY_BUFFER, m_VBO);
-            glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(vertices), vertices);
+                vertex(xpos,     ypos + h, glyph.uvMin.x, glyph.uvMin.y);
+                vertex(xpos,     ypos,     glyph.uvMin.x, glyph.uvMax.y);
+                vertex(xpos + w, ypos,     glyph.uvMax.x, glyph.uvMax.y);
 
-            glDrawArrays(GL_TRIANGLES, 0, 6);
+                vertex(xpos,     ypos + h, glyph.uvMin.x, glyph.uvMin.y);
+                vertex(xpos + w, ypos,     glyph.uvMax.x, glyph.uvMax.y);
+                vertex(xpos + w, ypos + h, glyph.uvMax.x, glyph.uvMin.y);
+            }
 
             x += (glyph.advance >> 6) * scale;
         }
+    }
+
+    void Text::flush(){
+        if(m_Vertices.empty()){
+            return;
+        }
+        glEnable(GL_BLEND);
+        glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+
+        m_Shader->bind();
+        glActiveTexture(GL_TEXTURE0);
+        glBindTexture(GL_TEXTURE_2D, m_Font->atlas);
+
+        glBindVertexArray(m_VAO);
+        glBindBuffer(GL_ARRAY_BUFFER, m_VBO);
+        if(m_Vertices.size() > m_VertexCapacity){
+            m_VertexCapacity = std::max(m_Vertices.size(), 2 * m_VertexCapacity);
+            glBufferData(GL_ARRAY_BUFFER, m_VertexCapacity * sizeof(float), nullptr, GL_DYNAMIC_DRAW);
+        }
+        glBufferSubData(GL_ARRAY_BUFFER, 0, m_Vertices.size() * sizeof(float), m_Vertices.data());
 
+        glDrawArrays(GL_TRIANGLES, 0, (GLsizei)(m_Vertices.size() / 7));
+        m_Vertices.clear();
+
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
         glBindVertexArray(0);
         glBindTexture(GL_TEXTURE_2D, 0);
     }
-}
\ No newline at end of file
+}
@@ -1,35 +1,67 @@
 #pragma once
 
 #include <glm/glm.hpp>
-#include <unordered_map>
+#include <array>
 #include <string>
+#include <vector>
 #include "Shader.h"
 
 namespace notlab{
 
     struct Glyph
     {
-        unsigned int texture = 0;
+        /// Corners of glyph in atlas, top left and bottom right.
+        glm::vec2 uvMin{};
+        glm::vec2 uvMax{};
         glm::ivec2 size{};
         glm::ivec2 bearing{};
         unsigned int advance = 0;
     };
 
+    /**
+     * @brief Rasterized glyphs of one font at one pixel height, see ResourceCache::getFont.
+     * @details All glyphs are packed into one texture, indexed by character code.
+     */
+    struct Font
+    {
+        unsigned int atlas = 0;
+        /// Characters outside printable ASCII are empty and take no space.
+        std::array<Glyph, 128> glyphs{};
+    };
+
 
 
     class Text{
         private:
-            std::unordered_map<char, Glyph> m_Glyphs;
-            unsigned int m_VAO;
-            unsigned int m_VBO;
-            Shader* m_Shader;
+            /// Owned by ResourceCache and shared by texts of all figures.
+            const Font* m_Font = nullptr;
+            Shader* m_Shader = nullptr;
+            /// Vertex arrays aren't shared between contexts, so every text has its own.
+            unsigned int m_VAO = 0;
+            unsigned int m_VBO = 0;
+            size_t m_VertexCapacity = 0;
+            /// Queued glyph quads, x and y already in clip space, then u, v and color.
+            std::vector<float> m_Vertices;
 
         public:
             ~Text();
 
             int init(const std::string& fontPath, int pixelHeight);
+
+            /**
+             * @brief Queues text at screen position, drawn by next flush.
+             */
             void drawScreen(const std::string& text, float x, float y, float scale, const glm::vec3& color, const glm::mat4& projection, const glm::mat4& model = glm::mat4(1.0f));
+
+            /**
+             * @brief Queues text at world position, drawn by next flush.
+             */
             void drawWorld(const std::string& text, float x, float y, float scale, const glm::vec3& color, const glm::mat4& projection, const glm::mat4& view, const glm::mat4& model = glm::mat4(1.0f));
+
+            /**
+             * @brief Draws all queued text with one upload and one draw call.
+             */
+            void flush();
     };
 
 }
\ No newline at end of file